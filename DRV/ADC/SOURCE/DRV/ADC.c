@@ -10,6 +10,7 @@
 
 #include "ADC.h"
 #include "stm32f4xx.h"
+#include "sys_cfg_stm32f407.h"
 
 /** @defgroup CLK Enable
  * @{
@@ -21,6 +22,9 @@
  * @}
  */
 
+/* Sys_Periph_t of an ADC_Hardware (ADC_1..ADC_3) */
+#define ADC_PERIPH(Hardware) ((Sys_Periph_t)(SYS_PERIPH_ADC1 + (Hardware)))
+
 /** @defgroup GPIO Mode Macros
  * @{
  */
@@ -137,17 +141,17 @@ ReturnCode_t ADC_Init(uint8_t ID, ADC_Parameters_t ADC_Configuration)
       {
         case ADC_1:
           /* Enable Clock */
-          SET_BIT(RCC->APB2ENR, RCC_APB2ENR_ADC1EN);
+          Sys_Periph_Clock_Get(SYS_PERIPH_ADC1);
           Instance = ADC1;
           break;
         case ADC_2:
           /* Enable Clock */
-          SET_BIT(RCC->APB2ENR, RCC_APB2ENR_ADC2EN);
+          Sys_Periph_Clock_Get(SYS_PERIPH_ADC2);
           Instance = ADC2;
           break;
         case ADC_3:
           /* Enable Clock */
-          SET_BIT(RCC->APB2ENR, RCC_APB2ENR_ADC3EN);
+          Sys_Periph_Clock_Get(SYS_PERIPH_ADC3);
           Instance = ADC3;
           break;
       }
@@ -200,6 +204,8 @@ ReturnCode_t ADC_Init(uint8_t ID, ADC_Parameters_t ADC_Configuration)
 
       Instance->CR2 |=  ADC_CR2_ADON;
 
+      Sys_Periph_Clock_Init_Done(ADC_PERIPH(ADC_Configuration.ADC_Hardware));
+
       Flag_ADC_Initialized[ID] = 1; // Mark if the ADC is already initialized
 
       RetCode = ANSWERED_REQUEST;
@@ -400,6 +406,7 @@ ReturnCode_t ADC_Read(uint8_t ID, uint32_t *Buffer, uint32_t Number_Of_Samples)
         }
         else
         {
+          Sys_Periph_Clock_Get(ADC_PERIPH(ADC_Hardware)); // Clock held until the conversions end
           switch (ADC_Hardware)
           {
             case ADC_1:
@@ -452,6 +459,7 @@ ReturnCode_t ADC_Read(uint8_t ID, uint32_t *Buffer, uint32_t Number_Of_Samples)
         if(Sample_Counter[ADC_Hardware] >= Number_Of_Samples_To_Read[ADC_Hardware])
         {
           ADC_Driver_Mutex_Release(&ADC_Channels_Mutex[ID_ADC]); // Unlock the driver for others ID's
+          Sys_Periph_Clock_Put(ADC_PERIPH(ADC_Hardware));
           ADC_Channel_List[ID].State = State_Configuring;
           RetCode = ANSWERED_REQUEST;
         }
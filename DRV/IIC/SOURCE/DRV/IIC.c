@@ -113,6 +113,7 @@
 void I2C_Set_Speed(I2C_TypeDef *I2C_x, uint32_t PeriphClock, uint32_t ClockSpeed, uint32_t DutyCycle);
 void IIC_Initialize(uint8_t ID, I2C_TypeDef *IIC_Instance);
 void IIC_DeInit(uint8_t ID);
+static Sys_Periph_t IIC_Periph(I2C_TypeDef *IIC_Instance);
 
 ReturnCode_t IIC_Write(I2C_TypeDef *IIC_Instance, I2C_Handler_t *IIC_Handler, uint8_t Device_Address, uint32_t Register_Address, uint8_t Register_Address_Size, uint8_t *Transmit_Buffer, uint16_t Transmit_Size);
 ReturnCode_t IIC_Read(I2C_TypeDef *IIC_Instance, I2C_Handler_t *IIC_Handler, uint8_t Device_Address, uint32_t Register_Address, uint8_t Register_Address_Size, uint8_t *Receive_Buffer, uint16_t Receive_Size);
@@ -347,6 +348,7 @@ ReturnCode_t IIC_Read(I2C_TypeDef *IIC_Instance, I2C_Handler_t *IIC_Handler, uin
 		IIC_Handler->Status					= IIC_BUSY_WRITE;
 		IIC_Handler->Mode					= IIC_WRITE;
 		IIC_Handler->Op_Type					= IIC_MEM_READ;
+		Sys_Periph_Clock_Get(IIC_Periph(IIC_Instance)); // Clock held until the transfer ends
 		Dummy_8bit = IIC_Instance->DR;
 		(void)Dummy_8bit;
 		SET_BIT(IIC_Instance->CR1, I2C_CR1_START); // Generate a start bit
@@ -358,11 +360,13 @@ ReturnCode_t IIC_Read(I2C_TypeDef *IIC_Instance, I2C_Handler_t *IIC_Handler, uin
 		if(IIC_Handler->Status == IIC_IDLE)
 		{
 			IIC_Handler->State_Machine_IIC = STATE_IIC_Prepare_Operation;
+			Sys_Periph_Clock_Put(IIC_Periph(IIC_Instance));
 			goto return_answered_request;
 		} else if(IIC_Handler->Status == IIC_ERROR)
 		{
 			IIC_Handler->Status = IIC_IDLE;
 			IIC_Handler->State_Machine_IIC = STATE_IIC_Prepare_Operation;
+			Sys_Periph_Clock_Put(IIC_Periph(IIC_Instance));
 			//SET_BIT(IIC_Instance->CR1, I2C_CR1_STOP);
 			goto return_err_device;
 		}
@@ -393,6 +397,7 @@ ReturnCode_t IIC_Write(I2C_TypeDef *IIC_Instance, I2C_Handler_t *IIC_Handler, ui
 		IIC_Handler->Status					= IIC_BUSY_WRITE;
 		IIC_Handler->Mode					= IIC_WRITE;
 		IIC_Handler->Op_Type				= IIC_MEM_WRITE;
+		Sys_Periph_Clock_Get(IIC_Periph(IIC_Instance)); // Clock held until the transfer ends
 		Dummy_8bit = IIC_Instance->DR;
 		(void)Dummy_8bit;
 		SET_BIT(IIC_Instance->CR1, I2C_CR1_START); // Generate a start bit
@@ -404,11 +409,13 @@ ReturnCode_t IIC_Write(I2C_TypeDef *IIC_Instance, I2C_Handler_t *IIC_Handler, ui
 		if(IIC_Handler->Status == IIC_IDLE)
 		{
 			IIC_Handler->State_Machine_IIC = STATE_IIC_Prepare_Operation;
+			Sys_Periph_Clock_Put(IIC_Periph(IIC_Instance));
 			goto return_answered_request;
 		} else if(IIC_Handler->Status == IIC_ERROR)
 		{
 			IIC_Handler->Status = IIC_IDLE;
 			IIC_Handler->State_Machine_IIC = STATE_IIC_Prepare_Operation;
+			Sys_Periph_Clock_Put(IIC_Periph(IIC_Instance));
 			//SET_BIT(IIC_Instance->CR1, I2C_CR1_STOP);
 			goto return_err_device;
 		}
@@ -477,12 +484,7 @@ void IIC_DeInit(uint8_t ID)
 void IIC_Initialize(uint8_t ID, I2C_TypeDef *IIC_Instance)
 {
 	// Enable I2C peripheral clock
-	if(IIC_Instance == I2C1)
-		SET_BIT(RCC->APB1ENR, RCC_APB1ENR_I2C1EN);
-	else if (IIC_Instance == I2C2)
-		SET_BIT(RCC->APB1ENR, RCC_APB1ENR_I2C2EN);
-	else if (IIC_Instance == I2C3)
-		SET_BIT(RCC->APB1ENR, RCC_APB1ENR_I2C3EN);
+	Sys_Periph_Clock_Get(IIC_Periph(IIC_Instance));
 
 	// Disable  acknowledge on Own Address2 match address.
 	CLEAR_BIT(IIC_Instance->OAR2, I2C_OAR2_ENDUAL);
@@ -530,6 +532,16 @@ void IIC_Initialize(uint8_t ID, I2C_TypeDef *IIC_Instance)
 	// Set own address2
 	MODIFY_REG(IIC_Instance->OAR2, I2C_OAR2_ADD2, 0);
 
+	Sys_Periph_Clock_Init_Done(IIC_Periph(IIC_Instance));
+}
+
+static Sys_Periph_t IIC_Periph(I2C_TypeDef *IIC_Instance)
+{
+	if(IIC_Instance == I2C1)
+		return SYS_PERIPH_I2C1;
+	else if (IIC_Instance == I2C2)
+		return SYS_PERIPH_I2C2;
+	return SYS_PERIPH_I2C3;
 }
 
 void I2C_Set_Speed(I2C_TypeDef *I2C_x, uint32_t PeriphClock, uint32_t ClockSpeed, uint32_t DutyCycle)
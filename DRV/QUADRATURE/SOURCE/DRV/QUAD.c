@@ -158,11 +158,13 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
   }
   else
   {
+    /* The encoder counts between the jobs too: the clock reference taken here
+     * is kept, even with SYS_PERIPH_GATING */
     switch(Encoder->QUAD_Routed)
     {
       case TIM1_ENCODER_CH1_CH2_AT_PE9_PE11:
         TIM_BASE = TIM1;
-        SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM1EN);
+        Sys_Periph_Clock_Get(SYS_PERIPH_TIM1);
         GPIOE_CLK_ENABLE();
         /* Setting TIM1 GPIO Channels
          * TIM1_CH1->PE9
@@ -202,7 +204,7 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
 
       case TIM2_ENCODER_CH1_CH2_AT_PA5_PB3:
         TIM_BASE = TIM2;
-        SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM2EN);
+        Sys_Periph_Clock_Get(SYS_PERIPH_TIM2);
         GPIOA_CLK_ENABLE();
         GPIOB_CLK_ENABLE();
         /* Setting TIM1 GPIO Channels
@@ -243,7 +245,7 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
 
       case TIM3_ENCODER_CH1_CH2_AT_PA6_PA7:
         TIM_BASE = TIM3;
-        SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM3EN);
+        Sys_Periph_Clock_Get(SYS_PERIPH_TIM3);
         GPIOA_CLK_ENABLE();
         /* Setting TIM1 GPIO Channels
          * TIM3_CH1->PA6
@@ -283,7 +285,7 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
 
       case TIM4_ENCODER_CH1_CH2_AT_PD12_PD13:
         TIM_BASE = TIM4;
-        SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM4EN);
+        Sys_Periph_Clock_Get(SYS_PERIPH_TIM4);
         GPIOD_CLK_ENABLE();
         /* Setting TIM1 GPIO Channels
          * TIM4_CH1->PD12
@@ -323,7 +325,7 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
 
       case TIM5_ENCODER_CH1_CH2_AT_PA0_PA1:
         TIM_BASE = TIM5;
-        SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM5EN);
+        Sys_Periph_Clock_Get(SYS_PERIPH_TIM5);
         GPIOA_CLK_ENABLE();
         /* Setting TIM1 GPIO Channels
          * TIM5_CH1->PA0
@@ -363,7 +365,7 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
 
       case TIM8_ENCODER_CH1_CH2_AT_PC6_PC7:
             TIM_BASE = TIM8;
-            SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM8EN);
+            Sys_Periph_Clock_Get(SYS_PERIPH_TIM8);
             GPIOC_CLK_ENABLE();
             /* Setting TIM8 GPIO Channels
              * TIM8_CH1->PC6
@@ -403,7 +405,7 @@ ReturnCode_t QUAD_Init(uint8 ID, QUAD_Parameters_t * Encoder )
 
       case TIM3_ENCODER_CH1_CH2_AT_PB4_PB5:
         TIM_BASE = TIM3;
-        SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM3EN);
+        Sys_Periph_Clock_Get(SYS_PERIPH_TIM3);
         GPIOB_CLK_ENABLE();
         /* Setting TIM1 GPIO Channels
          * TIM3_CH1->PB4
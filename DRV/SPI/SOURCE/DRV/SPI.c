@@ -10,6 +10,7 @@
 #include "stm32f4xx.h"
 #include <string.h>
 #include "returncode.h"
+#include "sys_cfg_stm32f407.h"
 
 /* *****************************************************************************
  *        PRIVATE DEFINITIONS
@@ -94,6 +95,7 @@ static void   	SPI_CSinit(uint8_t ID);
 static void   	SPI_ChipUnselect(uint8_t ID);
 
 static void   	SPI_Device_Setup(SPI_Handler_t	SPI_Device);
+static Sys_Periph_t	SPI_Periph(SPI_TypeDef *SPI_Instance);
 ReturnCode_t   	SPI_Device_Send(uint8_t ID, uint8_t *SendBuffer, uint16_t SendLength);
 ReturnCode_t   	SPI_Device_Receive(uint8_t ID, uint8_t *RecvBuffer, uint16_t RecvLenght);
 ReturnCode_t  	SPI_Device_Send_Receive(uint8_t ID, uint8_t *SendBuffer, uint8_t *RecvBuffer, uint16_t Size);
@@ -546,6 +548,7 @@ ReturnCode_t   	SPI_Device_Send(uint8_t ID, uint8_t *SendBuffer, uint16_t SendLe
 	switch (SPI_Device_Ctrl[ID].Buffer_Status->State)
 	{
 	case SPI_STATE_IDLE_TX_RX:
+		Sys_Periph_Clock_Get(SPI_Periph(SPI_Device_Ctrl[ID].SPI_Instance));	// Clock held until the transfer ends
 		SPI_ChipSelect(ID);
 		SPI_Device_Ctrl[ID].Buffer_Status->RX_Size   = SendLength;
 		SPI_Device_Ctrl[ID].Buffer_Status->Rx_Buffer = NULL;
@@ -566,6 +569,7 @@ ReturnCode_t   	SPI_Device_Send(uint8_t ID, uint8_t *SendBuffer, uint16_t SendLe
 		break;
 	case SPI_STATE_END_TX_RX:
 		SPI_ChipUnselect(ID);
+		Sys_Periph_Clock_Put(SPI_Periph(SPI_Device_Ctrl[ID].SPI_Instance));
 		ReturnCode = ANSWERED_REQUEST;
 		SPI_Device_Ctrl[ID].Buffer_Status->State = SPI_STATE_IDLE_TX_RX;
 		break;
@@ -584,6 +588,7 @@ ReturnCode_t   	SPI_Device_Receive(uint8_t ID, uint8_t *RecvBuffer, uint16_t Rec
 	switch (SPI_Device_Ctrl[ID].Buffer_Status->State)
 	{
 	case SPI_STATE_IDLE_TX_RX:
+		Sys_Periph_Clock_Get(SPI_Periph(SPI_Device_Ctrl[ID].SPI_Instance));	// Clock held until the transfer ends
 		SPI_ChipSelect(ID);
 		SPI_Device_Ctrl[ID].Buffer_Status->RX_Size   = RecvLenght;
 		SPI_Device_Ctrl[ID].Buffer_Status->Rx_Buffer = RecvBuffer;
@@ -604,6 +609,7 @@ ReturnCode_t   	SPI_Device_Receive(uint8_t ID, uint8_t *RecvBuffer, uint16_t Rec
 		break;
 	case SPI_STATE_END_TX_RX:
 		SPI_ChipUnselect(ID);
+		Sys_Periph_Clock_Put(SPI_Periph(SPI_Device_Ctrl[ID].SPI_Instance));
 		ReturnCode = ANSWERED_REQUEST;
 		SPI_Device_Ctrl[ID].Buffer_Status->State = SPI_STATE_IDLE_TX_RX;
 		break;
@@ -622,6 +628,7 @@ ReturnCode_t  	SPI_Device_Send_Receive(uint8_t ID, uint8_t *SendBuffer, uint8_t
 	switch (SPI_Device_Ctrl[ID].Buffer_Status->State)
 	{
 	case SPI_STATE_IDLE_TX_RX:
+		Sys_Periph_Clock_Get(SPI_Periph(SPI_Device_Ctrl[ID].SPI_Instance));	// Clock held until the transfer ends
 		SPI_ChipSelect(ID);
 		SPI_Device_Ctrl[ID].Buffer_Status->RX_Size   = Size;
 		SPI_Device_Ctrl[ID].Buffer_Status->Rx_Buffer = RecvBuffer;
@@ -642,6 +649,7 @@ ReturnCode_t  	SPI_Device_Send_Receive(uint8_t ID, uint8_t *SendBuffer, uint8_t
 		break;
 	case SPI_STATE_END_TX_RX:
 		SPI_ChipUnselect(ID);
+		Sys_Periph_Clock_Put(SPI_Periph(SPI_Device_Ctrl[ID].SPI_Instance));
 		ReturnCode = ANSWERED_REQUEST;
 		SPI_Device_Ctrl[ID].Buffer_Status->State = SPI_STATE_IDLE_TX_RX;
 		break;
@@ -658,18 +666,7 @@ static void   	SPI_Device_Setup(SPI_Handler_t	SPI_Device)
 	 * 1 is attached to APB2 -> 84MHz
 	 * 2 and 3 is attached to APB1  -> 42MHz
 	 */
-	if((SPI_Device.SPI_Instance) == SPI1)
-	{
-		RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
-	}
-	else if((SPI_Device.SPI_Instance) == SPI2)
-	{
-		RCC->APB1ENR |= RCC_APB1ENR_SPI2EN;
-	}
-	else if((SPI_Device.SPI_Instance) == SPI3)
-	{
-		RCC->APB1ENR |= RCC_APB1ENR_SPI3EN;
-	}
+	Sys_Periph_Clock_Get(SPI_Periph(SPI_Device.SPI_Instance));
 
 
 	SPI_Device.SPI_Instance->CR1 = 0x00;
@@ -703,6 +700,17 @@ static void   	SPI_Device_Setup(SPI_Handler_t	SPI_Device)
 		NVIC_SetPriority(SPI3_IRQn, NVIC_EncodePriority(0, 0, 0));
 		NVIC_EnableIRQ(SPI3_IRQn);;
 	}
+
+	Sys_Periph_Clock_Init_Done(SPI_Periph(SPI_Device.SPI_Instance));
+}
+
+static Sys_Periph_t	SPI_Periph(SPI_TypeDef *SPI_Instance)
+{
+	if(SPI_Instance == SPI1)
+		return SYS_PERIPH_SPI1;
+	else if(SPI_Instance == SPI2)
+		return SYS_PERIPH_SPI2;
+	return SYS_PERIPH_SPI3;
 }
 
 
@@ -23,6 +23,55 @@
 
 uint32_t SysTick_Counter;
 
+/* Clock levels, fastest first (typical currents from the STM32F407 datasheet,
+ * to be measured again on the board) */
+const Sys_Clock_Level_t Sys_Clock_Table[SYS_CLOCK_LEVELS] =
+{
+  /*  Hz         PllN  PllP  PllQ  WS  Vos  RunUA */
+  { 168000000,   168,  2,    7,    5,  1,   46000 },
+  { 120000000,   120,  2,    5,    3,  0,   32000 },
+  {  84000000,   168,  4,    7,    2,  0,   23000 },
+  {  48000000,    96,  4,    4,    1,  0,   14000 },
+};
+
+/* RCC enable register and bit of each Sys_Periph_t */
+#define SYS_PERIPH_APB1                0
+#define SYS_PERIPH_APB2                1
+
+static const struct
+{
+  uint8_t  Bus;
+  uint32_t Bit;
+} Sys_Periph_Clock[SYS_PERIPH_COUNT] =
+{
+  { SYS_PERIPH_APB2, RCC_APB2ENR_USART1EN },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_USART2EN },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_USART3EN },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_USART6EN },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_SPI1EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_SPI2EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_SPI3EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_I2C1EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_I2C2EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_I2C3EN   },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_ADC1EN   },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_ADC2EN   },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_ADC3EN   },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_TIM1EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_TIM2EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_TIM3EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_TIM4EN   },
+  { SYS_PERIPH_APB1, RCC_APB1ENR_TIM5EN   },
+  { SYS_PERIPH_APB2, RCC_APB2ENR_TIM8EN   },
+};
+
+/* Clock references of each peripheral */
+static uint8_t Sys_Periph_Refs[SYS_PERIPH_COUNT];
+
+/* Kernel timer (TIM5) overflow count and compare event callback */
+volatile uint32_t Sys_Kernel_Timer_Overflow;
+void (*Sys_Kernel_Timer_Callback)(void);
+
 /**
  * @brief Enable the SYSCFG, COMP, VREFBUF clock and Power interface clock
  * @param  None
@@ -42,6 +91,117 @@ void Sys_Enable_Peripherals_Clock(void)
   NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
 }
 
+/* RCC enable bit of a peripheral on (Get) or off, interrupts masked */
+static void Sys_Periph_Clock_Ref(Sys_Periph_t Periph, uint8_t Get)
+{
+  volatile uint32_t *Enr;
+
+  Enr = (Sys_Periph_Clock[Periph].Bus == SYS_PERIPH_APB1) ? &RCC->APB1ENR : &RCC->APB2ENR;
+
+  if(Get)
+  {
+    if(Sys_Periph_Refs[Periph]++ == 0)
+    {
+      SET_BIT(*Enr, Sys_Periph_Clock[Periph].Bit);
+      // Read back: the errata sheet asks for a delay after the clock enabling
+      (void)READ_BIT(*Enr, Sys_Periph_Clock[Periph].Bit);
+    }
+  }
+  else if(Sys_Periph_Refs[Periph] != 0)
+  {
+    if(--Sys_Periph_Refs[Periph] == 0)
+      CLEAR_BIT(*Enr, Sys_Periph_Clock[Periph].Bit);
+  }
+}
+
+/* Reference on (Get) or off every peripheral of a mask */
+static void Sys_Periph_Clock_Ref_Mask(uint32_t Mask, uint8_t Get)
+{
+  uint32_t Primask = __get_PRIMASK();
+  uint32_t Periph;
+
+  __disable_irq();
+  for(Periph = 0; Mask != 0 && Periph < SYS_PERIPH_COUNT; Periph++, Mask >>= 1)
+  {
+    if(Mask & 1)
+      Sys_Periph_Clock_Ref((Sys_Periph_t)Periph, Get);
+  }
+  __set_PRIMASK(Primask);
+}
+
+/**
+ * @brief Take a reference on the clock of a peripheral
+ * @param  Periph : peripheral
+ * @retval None
+ */
+void Sys_Periph_Clock_Get(Sys_Periph_t Periph)
+{
+  Sys_Periph_Clock_Ref_Mask(SYS_PERIPH_BIT(Periph), 1);
+}
+
+/**
+ * @brief Give a reference on the clock of a peripheral back
+ * @param  Periph : peripheral
+ * @retval None
+ */
+void Sys_Periph_Clock_Put(Sys_Periph_t Periph)
+{
+  Sys_Periph_Clock_Ref_Mask(SYS_PERIPH_BIT(Periph), 0);
+}
+
+/**
+ * @brief Take a reference on the clock of every peripheral of a mask
+ * @param  Mask : SYS_PERIPH_BIT() of the peripherals
+ * @retval None
+ */
+void Sys_Periph_Clock_Get_Mask(uint32_t Mask)
+{
+  Sys_Periph_Clock_Ref_Mask(Mask, 1);
+}
+
+/**
+ * @brief Give back a reference on the clock of every peripheral of a mask
+ * @param  Mask : SYS_PERIPH_BIT() of the peripherals
+ * @retval None
+ */
+void Sys_Periph_Clock_Put_Mask(uint32_t Mask)
+{
+  Sys_Periph_Clock_Ref_Mask(Mask, 0);
+}
+
+/**
+ * @brief End of a driver initialization: the reference taken for the
+ *        configuration is given back under SYS_PERIPH_GATING
+ * @param  Periph : peripheral
+ * @retval None
+ */
+void Sys_Periph_Clock_Init_Done(Sys_Periph_t Periph)
+{
+#if (SYS_PERIPH_GATING == 1)
+  Sys_Periph_Clock_Put(Periph);
+#else
+  (void)Periph;
+#endif
+}
+
+/**
+ * @brief Mask of the peripherals whose clock is on
+ * @param  None
+ * @retval SYS_PERIPH_BIT() of the referenced peripherals
+ */
+uint32_t Sys_Periph_Clock_On(void)
+{
+  uint32_t Mask = 0;
+  uint32_t Periph;
+
+  for(Periph = 0; Periph < SYS_PERIPH_COUNT; Periph++)
+  {
+    if(Sys_Periph_Refs[Periph] != 0)
+      Mask |= SYS_PERIPH_BIT(Periph);
+  }
+  return Mask;
+}
+
 /**
  * @brief Configure the system clock to 168MHz
  * @param  None
@@ -167,6 +327,162 @@ void Sys_Configure_Clock_168MHz_HSI(void)
   SET_BIT(SysTick->CTRL, SysTick_CTRL_CLKSOURCE_Msk);
 }
 
+/**
+ * @brief Switch the system clock to a level of Sys_Clock_Table
+ * @param  Level : index in Sys_Clock_Table
+ * @retval Ticks that ended during the switch besides the pending one
+ */
+uint32_t Sys_Configure_Clock_Level(uint8_t Level)
+{
+  const Sys_Clock_Level_t *Cfg = &Sys_Clock_Table[Level];
+  uint32_t Hz = SystemCoreClock, Load = SysTick->LOAD, Rest, Hse, Ticks = 0;
+  uint64_t Ns, Wait;
+
+  /* Speeding up: more wait states before the switch */
+  if(Cfg->FlashWs > (FLASH->ACR & FLASH_ACR_LATENCY))
+    MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, Cfg->FlashWs);
+
+  FLASH->ACR |= FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN;
+
+  /* SYSCLK from HSE while the PLL is reconfigured */
+  SET_BIT(RCC->CR, RCC_CR_HSEON);
+  while((RCC->CR & RCC_CR_HSERDY) != RCC_CR_HSERDY);
+
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_HSE);
+  while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSE);
+  Rest = SysTick->VAL;
+
+  CLEAR_BIT(RCC->CR, RCC_CR_PLLON);
+  while((RCC->CR & RCC_CR_PLLRDY) == RCC_CR_PLLRDY);
+
+  /* The regulator scale can only be changed with the PLL off */
+  MODIFY_REG(PWR->CR, PWR_CR_VOS, Cfg->Vos ? PWR_CR_VOS : 0);
+
+  RCC->PLLCFGR = RCC_PLLCFGR_PLLSRC_HSE                /* PLL source */
+      | (4 << 0)                                        /* PLL input division */
+      | (Cfg->PllN << 6)                                /* PLL multiplication */
+      | (((Cfg->PllP >> 1) - 1) << 16)                  /* PLL sys clock division */
+      | (Cfg->PllQ << 24);                              /* PLL usb clock division =48MHz */
+
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2,
+      RCC_CFGR_PPRE1_DIV4 | RCC_CFGR_PPRE2_DIV2);
+
+  SET_BIT(RCC->CR, RCC_CR_PLLON);
+  while((RCC->CR & RCC_CR_PLLRDY) != RCC_CR_PLLRDY);
+  while((PWR->CSR & PWR_CSR_VOSRDY) != PWR_CSR_VOSRDY);
+
+  Hse = SysTick->VAL;
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+  while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+
+  /* Slowing down: fewer wait states after the switch */
+  MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, Cfg->FlashWs);
+
+  SystemCoreClock = Cfg->Hz;
+
+  /* The rest of the tick in progress at the new rate (Sys_Tick_Rest), less
+   * the time at the HSE rate: the counts down to Hse, plus the old period
+   * when the counter reached 0 meanwhile. A tick that ended during the
+   * switch is pending (set here when the counter did not reach 0) and the
+   * next one is shorter by its delay. Then 1ms ticks */
+  if(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+  {
+    Ns   = (uint64_t)Rest * 1000000000ULL / Hz;
+    Wait = (uint64_t)((Hse <= Rest) ? Rest - Hse : Rest + Load + 1 - Hse) * 1000000000ULL / HSE_VALUE;
+    if(Ns > Wait)
+      Ns -= Wait;
+    else
+    {
+      if(Hse <= Rest)
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+      Ticks = (uint32_t)((Wait - Ns) / 1000000ULL);
+      Ns    = 1000000ULL - (Wait - Ns) % 1000000ULL;
+    }
+    Sys_Tick_Rest((uint32_t)(Ns * SystemCoreClock / 1000000000ULL));
+  }
+  else
+    SysTick->LOAD = (Cfg->Hz / 1000) - 1;
+
+  return Ticks;
+}
+
+/**
+ * @brief Start the clock restore after a STOP mode wake up
+ * @param  None
+ * @retval 1: started, 0: SYSCLK is not the HSI (no STOP, nothing to restore)
+ */
+uint8_t Sys_Stop_Wake_Begin(void)
+{
+  if((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI)
+    return 0;
+
+  /* STOP only turned the HSE and the PLL off: the flash wait states, the
+   * prescalers, the PLL configuration and the regulator scale are kept */
+  SET_BIT(RCC->CR, RCC_CR_HSEON);
+
+  SystemCoreClock = HSI_VALUE;
+
+  return 1;
+}
+
+/**
+ * @brief Advance the clock restore without waiting
+ * @param  None
+ * @retval 1: the PLL is locked
+ */
+uint8_t Sys_Stop_Wake_Ready(void)
+{
+  if((RCC->CR & RCC_CR_PLLON) != RCC_CR_PLLON)
+  {
+    if((RCC->CR & RCC_CR_HSERDY) != RCC_CR_HSERDY)
+      return 0;
+    SET_BIT(RCC->CR, RCC_CR_PLLON);
+  }
+
+  return ((RCC->CR & RCC_CR_PLLRDY) == RCC_CR_PLLRDY) ? 1 : 0;
+}
+
+/**
+ * @brief End the clock restore after a STOP mode wake up
+ * @param  Level : index in Sys_Clock_Table the PLL is configured for
+ * @retval None
+ */
+void Sys_Stop_Wake_Finish(uint8_t Level)
+{
+  uint32_t Rest;
+
+  while(Sys_Stop_Wake_Ready() == 0);
+  while((PWR->CSR & PWR_CSR_VOSRDY) != PWR_CSR_VOSRDY);
+
+  Rest = SysTick->VAL;
+
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+  while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+
+  SystemCoreClock = Sys_Clock_Table[Level].Hz;
+
+  if(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+  {
+    /* The rest of the tick in progress at the new rate, then 1ms ticks */
+    Sys_Tick_Rest((uint32_t)((uint64_t)Rest * SystemCoreClock / HSI_VALUE));
+  }
+}
+
+/**
+ * @brief Reload the SysTick with the rest of the tick in progress
+ * @param  Rest : SYSCLK cycles to the end of the tick in progress
+ * @retval None
+ */
+void Sys_Tick_Rest(uint32_t Rest)
+{
+  /* Loaded by the write to VAL (no count to 0, no interrupt), then the next
+   * ones are 1ms */
+  SysTick->LOAD = (Rest < 2) ? 2 : ((Rest > SysTick_LOAD_RELOAD_Msk) ? SysTick_LOAD_RELOAD_Msk : Rest);
+  SysTick->VAL  = 0;
+  while(SysTick->VAL == 0);
+  SysTick->LOAD = (SystemCoreClock / 1000) - 1;
+}
+
 /**
  * @brief Set the system clock to reset default values
  * @param  None
@@ -211,5 +527,287 @@ uint32_t Sys_Get_Tick(void)
   return (SysTick_Counter);
 }
 
+/**
+ * @brief Configure TIM5 as a free running 32-bit counter with a one shot
+ *        compare event (channel 1)
+ * @param  TickHz   : counter frequency (must divide SystemCoreClock/2)
+ * @param  Callback : called from TIM5_IRQHandler on each compare event
+ * @retval None
+ */
+void Sys_Kernel_Timer_Init(uint32_t TickHz, void (*Callback)(void))
+{
+  Sys_Kernel_Timer_Callback = Callback;
+  Sys_Kernel_Timer_Overflow = 0;
+
+  SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM5EN);
+
+  TIM5->CR1  = 0;
+  /* APB1 runs at SYSCLK/4, so the timer clock is SYSCLK/2 */
+  TIM5->PSC  = ((SystemCoreClock / 2) / TickHz) - 1;
+  TIM5->ARR  = 0xFFFFFFFF;
+  TIM5->CCMR1 = 0;                          /* Channel 1: frozen output compare */
+  TIM5->CCR1 = 0xFFFFFFFF;
+  TIM5->CNT  = 0;
+  TIM5->EGR  = TIM_EGR_UG;                  /* Load the prescaler */
+  TIM5->SR   = 0;
+  TIM5->DIER = TIM_DIER_UIE | TIM_DIER_CC1IE;
+
+  NVIC_SetPriority(TIM5_IRQn, (1UL << __NVIC_PRIO_BITS) - 1UL);
+  NVIC_EnableIRQ(TIM5_IRQn);
+
+  TIM5->CR1  = TIM_CR1_URS | TIM_CR1_CEN;  /* Update event only on overflow */
+}
 
+/**
+ * @brief Return the kernel time: TIM5 counter extended to 64 bits
+ * @param  None
+ * @retval Time in counts of TickHz
+ */
+uint64_t Sys_Kernel_Timer_Get(void)
+{
+  uint32_t High, Low;
 
+  do
+  {
+    High = Sys_Kernel_Timer_Overflow;
+    Low  = TIM5->CNT;
+  }while(High != Sys_Kernel_Timer_Overflow);
+
+  /* Overflow already happened but its interrupt is still pending */
+  if((TIM5->SR & TIM_SR_UIF) && (Low < 0x80000000U))
+    High++;
+
+  return ((uint64_t)High << 32) | Low;
+}
+
+/**
+ * @brief Arm the one shot compare event for an absolute kernel time
+ * @param  Time : absolute time in counts of TickHz
+ * @retval None
+ */
+void Sys_Kernel_Timer_Arm(uint64_t Time)
+{
+  uint64_t Now = Sys_Kernel_Timer_Get();
+
+  /* Far events are split, the callback arms again when it is reached */
+  if(Time > Now + 0x7FFFFFFFU)
+    Time = Now + 0x7FFFFFFFU;
+
+  TIM5->CCR1 = (uint32_t)Time;
+
+  if(Time <= Sys_Kernel_Timer_Get())
+    TIM5->EGR = TIM_EGR_CC1G;              /* Already passed: force the event */
+}
+
+/**
+ * @brief Start the RTC sub-second counter as a low power time reference
+ * @param  None
+ * @retval None
+ */
+void Sys_Lp_Ref_Start(void)
+{
+  SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
+
+  /* Enable write access to Backup domain */
+  PWR->CR |= PWR_CR_DBP;
+  while((PWR->CR & PWR_CR_DBP) == RESET);
+
+  /* No RTC clock selected yet: LSI (the selection is kept until a backup
+   * domain reset) */
+  if((RCC->BDCR & RCC_BDCR_RTCSEL) == 0)
+  {
+    SET_BIT(RCC->CSR, RCC_CSR_LSION);
+    while((RCC->CSR & RCC_CSR_LSIRDY) != RCC_CSR_LSIRDY);
+
+    MODIFY_REG(RCC->BDCR, RCC_BDCR_RTCSEL, RCC_BDCR_RTCSEL_1);
+  }
+  RCC->BDCR |= RCC_BDCR_RTCEN;
+
+  /* Unlock the RTC registers */
+  RTC->WPR = 0xCA;
+  RTC->WPR = 0x53;
+
+  RTC->ISR |= RTC_ISR_INIT;
+  while((RTC->ISR & RTC_ISR_INITF) != RTC_ISR_INITF);
+
+  /* Synchronous prescaler 32768: SSR counts at the RTC clock */
+  RTC->PRER = 0x7FFF;
+  RTC->PRER = (0 << 16) | 0x7FFF;
+
+  RTC->ISR &= ~RTC_ISR_INIT;
+
+  /* Read the counters, not the shadow registers */
+  RTC->CR |= RTC_CR_BYPSHAD;
+}
+
+/**
+ * @brief Give the RTC prescalers back their calendar values (1Hz)
+ * @param  None
+ * @retval None
+ */
+void Sys_Lp_Ref_Stop(void)
+{
+  RTC->ISR |= RTC_ISR_INIT;
+  while((RTC->ISR & RTC_ISR_INITF) != RTC_ISR_INITF);
+
+  /* 32768Hz (LSE) / 128 / 256 = 1Hz; the LSI (32kHz) gives 0.98Hz */
+  RTC->PRER = 0xFF;
+  RTC->PRER = (0x7F << 16) | 0xFF;
+
+  RTC->ISR &= ~RTC_ISR_INIT;
+  RTC->CR  &= ~RTC_CR_BYPSHAD;
+}
+
+/**
+ * @brief Read the reference counter: time of day in RTC clock counts
+ * @param  None
+ * @retval Counter value (seconds * 32768 + sub-second count)
+ */
+uint32_t Sys_Lp_Ref_Get(void)
+{
+  uint32_t Ssr, Tr;
+
+  /* The counters are read asynchronously: the time register is consistent
+   * when the sub-second count did not change while it was read */
+  do
+  {
+    Ssr = RTC->SSR;
+    Tr  = RTC->TR;
+  }while(Ssr != RTC->SSR);
+
+  Tr = (Tr & RTC_TR_SU)                              /* BCD to seconds */
+     + ((Tr & RTC_TR_ST)  >> RTC_TR_ST_Pos)  * 10
+     + ((Tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos) * 60
+     + ((Tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos) * 600
+     + ((Tr & RTC_TR_HU)  >> RTC_TR_HU_Pos)  * 3600
+     + ((Tr & RTC_TR_HT)  >> RTC_TR_HT_Pos)  * 36000;
+
+  return (Tr << 15) + ((0x7FFF - Ssr) & 0x7FFF);
+}
+
+/**
+ * @brief Counts between two reference readings (less than a day apart)
+ * @param  From : first reading
+ * @param  To   : second reading
+ * @retval Elapsed counts
+ */
+uint32_t Sys_Lp_Ref_Delta(uint32_t From, uint32_t To)
+{
+  if(To >= From)
+    return To - From;
+
+  /* Midnight in between */
+  return To + SYS_LP_REF_DAY - From;
+}
+
+/**
+ * @brief Arm the RTC wakeup timer for one wake up
+ * @param  Counts : periods of RTC clock/2 (1..65536)
+ * @retval None
+ */
+void Sys_Wakeup_Timer_Start(uint32_t Counts)
+{
+  RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+  while((RTC->ISR & RTC_ISR_WUTWF) != RTC_ISR_WUTWF);
+
+  RTC->WUTR = Counts - 1;
+  MODIFY_REG(RTC->CR, RTC_CR_WUCKSEL, RTC_CR_WUCKSEL_1 | RTC_CR_WUCKSEL_0);  /* RTC clock/2 */
+  RTC->ISR &= ~RTC_ISR_WUTF;
+
+  /* EXTI line 22 is the RTC wakeup event */
+  EXTI->PR    = EXTI_PR_PR22;
+  EXTI->IMR  |= EXTI_IMR_MR22;
+  EXTI->RTSR |= EXTI_RTSR_TR22;
+
+  NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+  NVIC_SetPriority(RTC_WKUP_IRQn, (1UL << __NVIC_PRIO_BITS) - 1UL);
+  NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+  RTC->CR |= RTC_CR_WUTE | RTC_CR_WUTIE;
+}
+
+/**
+ * @brief Disable the RTC wakeup timer and clear its pending event
+ * @param  None
+ * @retval None
+ */
+void Sys_Wakeup_Timer_Stop(void)
+{
+  RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+  RTC->ISR &= ~RTC_ISR_WUTF;
+
+  EXTI->IMR &= ~EXTI_IMR_MR22;
+  EXTI->PR   = EXTI_PR_PR22;
+
+  NVIC_DisableIRQ(RTC_WKUP_IRQn);
+  NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+}
+
+/**
+ * @brief Power the backup SRAM from the backup regulator and unlock it
+ * @param  None
+ * @retval None
+ */
+void Sys_Backup_Sram_Enable(void)
+{
+  SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
+
+  PWR->CR |= PWR_CR_DBP;
+  while((PWR->CR & PWR_CR_DBP) == RESET);
+
+  /* DBP and the RTC lock are cleared by the reset that ends Standby */
+  RTC->WPR = 0xCA;
+  RTC->WPR = 0x53;
+
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_BKPSRAMEN);
+
+  /* Retention in Standby and VBAT */
+  PWR->CSR |= PWR_CSR_BRE;
+  while((PWR->CSR & PWR_CSR_BRR) != PWR_CSR_BRR);
+}
+
+/**
+ * @brief Enter Standby until the RTC wakeup timer (RTC clock/16)
+ * @param  Counts : 1..65536
+ * @retval None
+ */
+void Sys_Enter_Standby(uint32_t Counts)
+{
+  RTC->WPR = 0xCA;
+  RTC->WPR = 0x53;
+
+  RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+  while((RTC->ISR & RTC_ISR_WUTWF) != RTC_ISR_WUTWF);
+
+  RTC->WUTR = Counts - 1;
+  MODIFY_REG(RTC->CR, RTC_CR_WUCKSEL, 0);    /* RTC clock/16 */
+
+  /* A wake up flag still set would end Standby at once */
+  RTC->ISR &= ~RTC_ISR_WUTF;
+  RTC->CR |= RTC_CR_WUTE | RTC_CR_WUTIE;
+  PWR->CR |= PWR_CR_CWUF;
+
+  PWR->CR |= PWR_CR_PDDS;
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  __DSB();
+
+  for(;;)
+    __WFI();
+}
+
+/**
+ * @brief Check and clear the Standby flag
+ * @param  None
+ * @retval 1: woken up from Standby, 0: any other reset
+ */
+uint8_t Sys_Standby_Resumed(void)
+{
+  uint8_t Resumed;
+
+  SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
+
+  Resumed = (PWR->CSR & PWR_CSR_SBF) ? 1 : 0;
+  PWR->CR |= PWR_CR_CSBF | PWR_CR_CWUF;
+
+  return Resumed;
+}
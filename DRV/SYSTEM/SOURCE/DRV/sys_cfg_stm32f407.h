@@ -22,6 +22,27 @@
 #define SYSTICK_CLKSOURCE_HCLK         0x00000004U
 extern uint32_t SysTick_Counter;
 
+/* Number of entries of Sys_Clock_Table (index 0 is the fastest) */
+#define SYS_CLOCK_LEVELS               4
+
+/**
+ * @brief Pre-validated PLL configuration of one clock level (HSE 8MHz, PLL
+ *        input 2MHz, USB clock kept at 48MHz). APB1 = SYSCLK/4 and
+ *        APB2 = SYSCLK/2 at every level, so the peripheral clocks scale too.
+ */
+typedef struct
+{
+  uint32_t Hz;        /* SYSCLK                                        */
+  uint16_t PllN;      /* VCO = 2MHz * PllN (100..432MHz)               */
+  uint8_t  PllP;      /* SYSCLK = VCO / PllP (2, 4, 6 or 8)            */
+  uint8_t  PllQ;      /* USB = VCO / PllQ = 48MHz                      */
+  uint8_t  FlashWs;   /* Flash wait states at 2.7..3.6V (RM0090 p80)   */
+  uint8_t  Vos;       /* 1: regulator scale 1 (above 144MHz), 0: scale 2 */
+  uint16_t RunUA;     /* typical run current, peripherals off (uA)     */
+} Sys_Clock_Level_t;
+
+extern const Sys_Clock_Level_t Sys_Clock_Table[SYS_CLOCK_LEVELS];
+
 /**
  * @brief Enable the SYSCFG, COMP, VREFBUF clock and Power interface clock
  * @param  None
@@ -29,6 +50,93 @@ extern uint32_t SysTick_Counter;
  */
 void Sys_Enable_Peripherals_Clock(void);
 
+/*
+ * 1: the drivers give their clock reference back once the peripheral is
+ * configured, so that a clock is only on while a user holds it (a kernel job
+ * that declared the peripheral, or a transfer in progress). The registers
+ * keep their content while the clock is off. 0: the clocks stay on from the
+ * driver initialization, as before.
+ */
+#ifndef SYS_PERIPH_GATING
+#define SYS_PERIPH_GATING              0
+#endif
+
+/* Peripherals whose RCC clock is reference counted (Sys_Periph_Clock_Get) */
+typedef enum
+{
+  SYS_PERIPH_USART1 = 0,
+  SYS_PERIPH_USART2,
+  SYS_PERIPH_USART3,
+  SYS_PERIPH_USART6,
+  SYS_PERIPH_SPI1,
+  SYS_PERIPH_SPI2,
+  SYS_PERIPH_SPI3,
+  SYS_PERIPH_I2C1,
+  SYS_PERIPH_I2C2,
+  SYS_PERIPH_I2C3,
+  SYS_PERIPH_ADC1,
+  SYS_PERIPH_ADC2,
+  SYS_PERIPH_ADC3,
+  SYS_PERIPH_TIM1,
+  SYS_PERIPH_TIM2,
+  SYS_PERIPH_TIM3,
+  SYS_PERIPH_TIM4,
+  SYS_PERIPH_TIM5,
+  SYS_PERIPH_TIM8,
+  SYS_PERIPH_COUNT
+} Sys_Periph_t;
+
+/* Bit of a peripheral in the masks of Sys_Periph_Clock_Get_Mask()          */
+#define SYS_PERIPH_BIT(Periph)         (1UL << (Periph))
+
+/**
+ * @brief Take a reference on the clock of a peripheral. The first one turns
+ *        the RCC enable bit on; the peripheral can be accessed on return.
+ *        Can be called from an interrupt.
+ * @param  Periph : peripheral
+ * @retval None
+ */
+void Sys_Periph_Clock_Get(Sys_Periph_t Periph);
+
+/**
+ * @brief Give a reference back. The last one turns the clock off.
+ *        Can be called from an interrupt.
+ * @param  Periph : peripheral
+ * @retval None
+ */
+void Sys_Periph_Clock_Put(Sys_Periph_t Periph);
+
+/**
+ * @brief Sys_Periph_Clock_Get() on every peripheral of a mask, in one
+ *        critical section
+ * @param  Mask : SYS_PERIPH_BIT() of the peripherals
+ * @retval None
+ */
+void Sys_Periph_Clock_Get_Mask(uint32_t Mask);
+
+/**
+ * @brief Sys_Periph_Clock_Put() on every peripheral of a mask, in one
+ *        critical section
+ * @param  Mask : SYS_PERIPH_BIT() of the peripherals
+ * @retval None
+ */
+void Sys_Periph_Clock_Put_Mask(uint32_t Mask);
+
+/**
+ * @brief Give back the reference of the driver initialization when
+ *        SYS_PERIPH_GATING is 1, keep it otherwise
+ * @param  Periph : peripheral
+ * @retval None
+ */
+void Sys_Periph_Clock_Init_Done(Sys_Periph_t Periph);
+
+/**
+ * @brief Mask of the peripherals whose clock is on
+ * @param  None
+ * @retval SYS_PERIPH_BIT() of the referenced peripherals
+ */
+uint32_t Sys_Periph_Clock_On(void);
+
 /**
  * @brief Configure the system clock to 168MHz
  * @param  None
@@ -43,6 +151,59 @@ void Sys_Configure_Clock_168MHz(void);
  */
 void Sys_Configure_Clock_168MHz_HSI(void);
 
+/**
+ * @brief Switch the system clock to a level of Sys_Clock_Table. SYSCLK runs
+ *        from HSE while the PLL locks again; the flash wait states are raised
+ *        before and lowered after the switch. SystemCoreClock and the
+ *        SysTick reload (1ms) follow the new clock; the tick in progress
+ *        keeps its length. A tick that ended during the switch is pending
+ *        and the next one is shorter by its delay. Also used to leave the
+ *        HSI after a STOP mode wake up.
+ * @param  Level : index in Sys_Clock_Table
+ * @retval Ticks that ended during the switch besides the pending one
+ */
+uint32_t Sys_Configure_Clock_Level(uint8_t Level);
+
+/**
+ * @brief Fast clock restore after a STOP mode wake up, in three steps so that
+ *        the code can run on the HSI (16MHz) while the HSE starts and the PLL
+ *        locks. Begin starts the HSE and sets SystemCoreClock to the HSI;
+ *        Ready turns the PLL on once the HSE is ready and tells when it is
+ *        locked, without waiting; Finish waits for the lock and switches
+ *        SYSCLK to the PLL. Only what STOP loses is done again: the flash
+ *        wait states, the prescalers, the PLL configuration and the
+ *        regulator scale are kept from before the STOP entry.
+ * @param  None
+ * @retval 1: started, 0: SYSCLK is not the HSI (no STOP, nothing to restore)
+ */
+uint8_t Sys_Stop_Wake_Begin(void);
+
+/**
+ * @brief Advance the clock restore started by Sys_Stop_Wake_Begin()
+ * @param  None
+ * @retval 1: the PLL is locked, Sys_Stop_Wake_Finish() does not wait
+ */
+uint8_t Sys_Stop_Wake_Ready(void);
+
+/**
+ * @brief End the clock restore: wait for the PLL, switch SYSCLK to it and set
+ *        SystemCoreClock. When the SysTick runs, the tick in progress is
+ *        finished at the new rate and the next ones are 1ms, so the time is
+ *        kept across the switch.
+ * @param  Level : index in Sys_Clock_Table the PLL is configured for
+ * @retval None
+ */
+void Sys_Stop_Wake_Finish(uint8_t Level);
+
+/**
+ * @brief Reload the SysTick with the rest of the tick in progress, then 1ms
+ *        ticks at SystemCoreClock. The rest is loaded by the write to VAL:
+ *        no count to 0, no interrupt.
+ * @param  Rest : SYSCLK cycles to the end of the tick in progress
+ * @retval None
+ */
+void Sys_Tick_Rest(uint32_t Rest);
+
 /**
  * @brief Set the system clock to reset default values
  * @param  None
@@ -64,4 +225,110 @@ void Sys_Enable_LSE(void);
  */
 uint32_t	Sys_Get_Tick(void);
 
+/**
+ * @brief Configure TIM5 as a free running 32-bit counter with a one shot
+ *        compare event (channel 1), used as the kernel time base when the
+ *        periodic tick is disabled
+ * @param  TickHz   : counter frequency (must divide SystemCoreClock/2)
+ * @param  Callback : called from TIM5_IRQHandler on each compare event
+ * @retval None
+ * @note   The interrupt is set to the lowest priority, like the SysTick
+ */
+void Sys_Kernel_Timer_Init(uint32_t TickHz, void (*Callback)(void));
+
+/**
+ * @brief Return the kernel time: TIM5 counter extended to 64 bits by the
+ *        overflow count
+ * @param  None
+ * @retval Time in counts of TickHz
+ */
+uint64_t Sys_Kernel_Timer_Get(void);
+
+/**
+ * @brief Arm the one shot compare event for an absolute kernel time
+ * @param  Time : absolute time in counts of TickHz. If it has already passed
+ *         the event is generated immediately
+ * @retval None
+ */
+void Sys_Kernel_Timer_Arm(uint64_t Time);
+
+/**
+ * @brief Start the RTC sub-second counter as a time reference that keeps
+ *        running in SLEEP and STOP. The RTC clock is the LSE when it is
+ *        already running, else the LSI; the counter runs at the RTC clock
+ *        (asynchronous prescaler 1) and wraps every 32768 counts.
+ * @param  None
+ * @retval None
+ */
+void Sys_Lp_Ref_Start(void);
+
+/**
+ * @brief Give the RTC prescalers back their calendar values (1Hz)
+ * @param  None
+ * @retval None
+ */
+void Sys_Lp_Ref_Stop(void);
+
+/**
+ * @brief Read the reference counter: time of day in RTC clock counts. The
+ *        low 15 bits are the sub-second count, so short intervals can also
+ *        be taken modulo 32768.
+ * @param  None
+ * @retval Counter value (seconds * 32768 + sub-second count)
+ */
+uint32_t Sys_Lp_Ref_Get(void);
+
+/* Reference counts in a day (the counter wraps at midnight) */
+#define SYS_LP_REF_DAY                 (86400UL << 15)
+
+/**
+ * @brief Counts between two reference readings (less than a day apart)
+ * @param  From : first reading
+ * @param  To   : second reading
+ * @retval Elapsed counts
+ */
+uint32_t Sys_Lp_Ref_Delta(uint32_t From, uint32_t To);
+
+/**
+ * @brief Arm the RTC wakeup timer (EXTI line 22, RTC_WKUP_IRQn). It runs in
+ *        STOP mode and wakes the CPU up once, after Counts periods of RTC
+ *        clock/2.
+ * @param  Counts : 1..65536
+ * @retval None
+ */
+void Sys_Wakeup_Timer_Start(uint32_t Counts);
+
+/**
+ * @brief Disable the RTC wakeup timer and clear its pending event
+ * @param  None
+ * @retval None
+ */
+void Sys_Wakeup_Timer_Stop(void);
+
+/**
+ * @brief Power the 4KB backup SRAM (BKPSRAM_BASE) from the backup regulator,
+ *        so that it keeps its content in Standby, and give write access to it
+ *        and to the RTC registers
+ * @param  None
+ * @retval None
+ */
+void Sys_Backup_Sram_Enable(void);
+
+/**
+ * @brief Enter Standby, ended by the RTC wakeup timer after Counts periods of
+ *        RTC clock/16 (up to 32s with a 32768Hz clock). The wake up is a
+ *        reset: the function does not return.
+ * @param  Counts : 1..65536
+ * @retval None
+ */
+void Sys_Enter_Standby(uint32_t Counts);
+
+/**
+ * @brief Tell whether the last reset was the wake up from Standby, and clear
+ *        the Standby and wake up flags
+ * @param  None
+ * @retval 1: woken up from Standby, 0: any other reset
+ */
+uint8_t Sys_Standby_Resumed(void);
+
 #endif /* SYS_STM32F4XX_H_ */
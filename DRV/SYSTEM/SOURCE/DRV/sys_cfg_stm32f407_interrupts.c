@@ -12,6 +12,8 @@
 #include "stm32f4xx.h"
 
 extern uint32_t SysTick_Counter;
+extern volatile uint32_t Sys_Kernel_Timer_Overflow;
+extern void (*Sys_Kernel_Timer_Callback)(void);
 
 /**
  * @brief System tick IRQ
@@ -22,3 +24,35 @@ extern uint32_t SysTick_Counter;
 //{
 //	SysTick_Counter ++;
 //}
+
+/**
+ * @brief Kernel timer (TIM5) IRQ: counts overflows and runs the compare callback
+ * @param  None
+ * @retval None
+ */
+void TIM5_IRQHandler(void)
+{
+  if(TIM5->SR & TIM_SR_UIF)
+  {
+    TIM5->SR = ~TIM_SR_UIF;
+    Sys_Kernel_Timer_Overflow++;
+  }
+
+  if(TIM5->SR & TIM_SR_CC1IF)
+  {
+    TIM5->SR = ~TIM_SR_CC1IF;
+    if(Sys_Kernel_Timer_Callback != NULL)
+      Sys_Kernel_Timer_Callback();
+  }
+}
+
+/**
+ * @brief RTC wakeup timer IRQ (EXTI line 22): the wake up itself is the event
+ * @param  None
+ * @retval None
+ */
+void RTC_WKUP_IRQHandler(void)
+{
+  RTC->ISR &= ~RTC_ISR_WUTF;
+  EXTI->PR   = EXTI_PR_PR22;
+}
@@ -152,7 +152,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
       SET_GPIO_SPEED(GPIOA, 9, GPIO_OSPEED_HIGH_SPEED_100MHZ); // Output High Speed
 
       /* Enable UART1 Clock */
-      SET_BIT(RCC->APB2ENR, RCC_APB2ENR_USART1EN);
+      Sys_Periph_Clock_Get(SYS_PERIPH_USART1);
       /* Adjust UART2 configurations */
       /*
        * STM32F407 UARTs
@@ -169,6 +169,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
 
       UART_DeviceList[ID].State = UART_STATE_IDLE;
       UART1_Control.Locked_ID = UART_NOT_BUSY;
+      Sys_Periph_Clock_Init_Done(SYS_PERIPH_USART1);
 
       break;
 
@@ -203,7 +204,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
       SET_GPIO_SPEED(GPIOD, 5, GPIO_OSPEED_HIGH_SPEED_100MHZ); // Output High Speed
 
       /* Enable UART2 Clock */
-      SET_BIT(RCC->APB1ENR, RCC_APB1ENR_USART2EN);
+      Sys_Periph_Clock_Get(SYS_PERIPH_USART2);
       /* Adjust UART2 configurations */
       /*
        * STM32F407 UARTs
@@ -219,6 +220,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
 
       UART_DeviceList[ID].State = UART_STATE_IDLE;
       UART2_Control.Locked_ID = UART_NOT_BUSY;
+      Sys_Periph_Clock_Init_Done(SYS_PERIPH_USART2);
 
       break;
 
@@ -253,7 +255,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
       SET_GPIO_SPEED(GPIOD, 8, GPIO_OSPEED_HIGH_SPEED_100MHZ); // Output High Speed
 
       /* Enable UART3 Clock */
-      SET_BIT(RCC->APB1ENR, RCC_APB1ENR_USART3EN);
+      Sys_Periph_Clock_Get(SYS_PERIPH_USART3);
       /* Adjust UART3 configurations */
       /*
        * STM32F407 UARTs
@@ -269,6 +271,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
 
       UART_DeviceList[ID].State = UART_STATE_IDLE;
       UART3_Control.Locked_ID = UART_NOT_BUSY;
+      Sys_Periph_Clock_Init_Done(SYS_PERIPH_USART3);
 
       break;
 
@@ -303,7 +306,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
       SET_GPIO_SPEED(GPIOC, 7, GPIO_OSPEED_HIGH_SPEED_100MHZ); // Output High Speed
 
       /* Enable UART6 Clock */
-      SET_BIT(RCC->APB2ENR, RCC_APB2ENR_USART6EN);
+      Sys_Periph_Clock_Get(SYS_PERIPH_USART6);
       /* Adjust UART6 configurations */
       /*
        * STM32F407 UARTs
@@ -319,6 +322,7 @@ ReturnCode_t UART_Init(uint8_t ID, UART_Config_t ConfigUART) {
 
       UART_DeviceList[ID].State = UART_STATE_IDLE;
       UART6_Control.Locked_ID = UART_NOT_BUSY;
+      Sys_Periph_Clock_Init_Done(SYS_PERIPH_USART6);
 
       break;
     default:
@@ -352,6 +356,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
             UART_DeviceList[ID].Tx_Size = SendLength;
             if ((USART1->SR & USART_SR_TC) == USART_SR_TC) {
               UART1_Control.Locked_ID = ID; // Lock the UART to this ID
+              Sys_Periph_Clock_Get(SYS_PERIPH_USART1); // Clock held until the transfer ends
               UART1_Control.Transmit_Counter = 0;
               USART1->DR = (*UART1_Control.Transmit_Buffer);
               UART1_Control.Transmit_Buffer ++;
@@ -369,6 +374,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
             if (UART1_Control.Transmit_Counter >= UART_DeviceList[ID].Tx_Size) {
               CLEAR_BIT(USART1->CR1, USART_CR1_TCIE);
               UART1_Control.Locked_ID = UART_NOT_BUSY;
+              Sys_Periph_Clock_Put(SYS_PERIPH_USART1);
               UART_DeviceList[ID].State = UART_STATE_IDLE;
               ReturnCode = ANSWERED_REQUEST;
             }
@@ -393,6 +399,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
                 UART_DeviceList[ID].Tx_Size = SendLength;
                 if ((USART2->SR & USART_SR_TC) == USART_SR_TC) {
                   UART2_Control.Locked_ID = ID; // Lock the UART to this ID
+                  Sys_Periph_Clock_Get(SYS_PERIPH_USART2); // Clock held until the transfer ends
                   UART2_Control.Transmit_Counter = 0;
                   USART2->DR = *UART2_Control.Transmit_Buffer;
                   UART2_Control.Transmit_Buffer ++;
@@ -410,6 +417,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
                 if (UART2_Control.Transmit_Counter >= UART_DeviceList[ID].Tx_Size) {
                   CLEAR_BIT(USART2->CR1, USART_CR1_TCIE);
                   UART2_Control.Locked_ID = UART_NOT_BUSY;
+                  Sys_Periph_Clock_Put(SYS_PERIPH_USART2);
                   UART_DeviceList[ID].State = UART_STATE_IDLE;
                   ReturnCode = ANSWERED_REQUEST;
                 }
@@ -434,6 +442,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
                     UART_DeviceList[ID].Tx_Size = SendLength;
                     if ((USART3->SR & USART_SR_TC) == USART_SR_TC) {
                       UART3_Control.Locked_ID = ID; // Lock the UART to this ID
+                      Sys_Periph_Clock_Get(SYS_PERIPH_USART3); // Clock held until the transfer ends
                       UART3_Control.Transmit_Counter = 0;
                       USART3->DR = *UART3_Control.Transmit_Buffer;
                       UART3_Control.Transmit_Buffer ++;
@@ -451,6 +460,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
                     if (UART3_Control.Transmit_Counter >= UART_DeviceList[ID].Tx_Size) {
                       CLEAR_BIT(USART3->CR1, USART_CR1_TCIE);
                       UART3_Control.Locked_ID = UART_NOT_BUSY;
+                      Sys_Periph_Clock_Put(SYS_PERIPH_USART3);
                       UART_DeviceList[ID].State = UART_STATE_IDLE;
                       ReturnCode = ANSWERED_REQUEST;
                     }
@@ -475,6 +485,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
                         UART_DeviceList[ID].Tx_Size = SendLength;
                         if ((USART6->SR & USART_SR_TC) == USART_SR_TC) {
                           UART6_Control.Locked_ID = ID; // Lock the UART to this ID
+                          Sys_Periph_Clock_Get(SYS_PERIPH_USART6); // Clock held until the transfer ends
                           UART6_Control.Transmit_Counter = 0;
                           USART6->DR = *UART6_Control.Transmit_Buffer;
                           UART6_Control.Transmit_Buffer ++;
@@ -492,6 +503,7 @@ ReturnCode_t UART_SendData(uint8_t ID, uint8_t * SendBuffer, uint32_t SendLength
                         if (UART6_Control.Transmit_Counter >= UART_DeviceList[ID].Tx_Size) {
                           CLEAR_BIT(USART6->CR1, USART_CR1_TCIE);
                           UART6_Control.Locked_ID = UART_NOT_BUSY;
+                          Sys_Periph_Clock_Put(SYS_PERIPH_USART6);
                           UART_DeviceList[ID].State = UART_STATE_IDLE;
                           ReturnCode = ANSWERED_REQUEST;
                         }
@@ -538,6 +550,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
             UART_DeviceList[ID].Rx_Size = RecMaxSize;
             UART_DeviceList[ID].State = UART_STATE_RECEIVING;
             UART1_Control.Locked_ID = ID; // Lock the UART to this ID
+            Sys_Periph_Clock_Get(SYS_PERIPH_USART1); // Clock held until the transfer ends
           }
           break;
         case UART_STATE_RECEIVING:
@@ -548,6 +561,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
               UART1_Control.Receive_Counter = 0;
               UART_DeviceList[ID].State = UART_STATE_IDLE;
               UART1_Control.Locked_ID = UART_NOT_BUSY;
+              Sys_Periph_Clock_Put(SYS_PERIPH_USART1);
               ReturnCode = ANSWERED_REQUEST;
             }
             if (UART1_Control.Receive_Counter > 0)
@@ -567,6 +581,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                 //memcpy(UART_DeviceList[ID].Rx_Buffer + 2, UART1_Control.Receive_Buffer, UART1_Control.Receive_Counter);
                 UART_DeviceList[ID].State = UART_STATE_IDLE;
                 UART1_Control.Locked_ID = UART_NOT_BUSY;
+                Sys_Periph_Clock_Put(SYS_PERIPH_USART1);
                 ReturnCode = ANSWERED_REQUEST;
               }
             }
@@ -592,6 +607,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                 UART_DeviceList[ID].Rx_Size = RecMaxSize;
                 UART_DeviceList[ID].State = UART_STATE_RECEIVING;
                 UART2_Control.Locked_ID = ID; // Lock the UART to this ID
+                Sys_Periph_Clock_Get(SYS_PERIPH_USART2); // Clock held until the transfer ends
               }
               break;
             case UART_STATE_RECEIVING:
@@ -603,6 +619,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                   UART2_Control.Receive_Counter = 0;
                   UART_DeviceList[ID].State = UART_STATE_IDLE;
                   UART2_Control.Locked_ID = UART_NOT_BUSY;
+                  Sys_Periph_Clock_Put(SYS_PERIPH_USART2);
                   ReturnCode = ANSWERED_REQUEST;
                 }
                 if (UART2_Control.Receive_Counter > 0)
@@ -622,6 +639,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                     //memcpy(UART_DeviceList[ID].Rx_Buffer + 2, UART2_Control.Receive_Buffer, UART2_Control.Receive_Counter);
                     UART_DeviceList[ID].State = UART_STATE_IDLE;
                     UART2_Control.Locked_ID = UART_NOT_BUSY;
+                    Sys_Periph_Clock_Put(SYS_PERIPH_USART2);
                     ReturnCode = ANSWERED_REQUEST;
                   }
                 }
@@ -645,6 +663,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                     UART_DeviceList[ID].Rx_Size = RecMaxSize;
                     UART_DeviceList[ID].State = UART_STATE_RECEIVING;
                     UART3_Control.Locked_ID = ID; // Lock the UART to this ID
+                    Sys_Periph_Clock_Get(SYS_PERIPH_USART3); // Clock held until the transfer ends
                   }
                   break;
                 case UART_STATE_RECEIVING:
@@ -655,6 +674,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                       UART3_Control.Receive_Counter = 0;
                       UART_DeviceList[ID].State = UART_STATE_IDLE;
                       UART3_Control.Locked_ID = UART_NOT_BUSY;
+                      Sys_Periph_Clock_Put(SYS_PERIPH_USART3);
                       ReturnCode = ANSWERED_REQUEST;
                     }
                     if (UART3_Control.Receive_Counter > 0) {
@@ -670,6 +690,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                         //memcpy(UART_DeviceList[ID].Rx_Buffer + 2, UART3_Control.Receive_Buffer, UART3_Control.Receive_Counter);
                         UART_DeviceList[ID].State = UART_STATE_IDLE;
                         UART3_Control.Locked_ID = UART_NOT_BUSY;
+                        Sys_Periph_Clock_Put(SYS_PERIPH_USART3);
                         ReturnCode = ANSWERED_REQUEST;
                       }
                     }
@@ -693,6 +714,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                         UART_DeviceList[ID].Rx_Size = RecMaxSize;
                         UART_DeviceList[ID].State = UART_STATE_RECEIVING;
                         UART6_Control.Locked_ID = ID; // Lock the UART to this ID
+                        Sys_Periph_Clock_Get(SYS_PERIPH_USART6); // Clock held until the transfer ends
                       }
                       break;
                     case UART_STATE_RECEIVING:
@@ -703,6 +725,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                           UART6_Control.Receive_Counter = 0;
                           UART_DeviceList[ID].State = UART_STATE_IDLE;
                           UART6_Control.Locked_ID = UART_NOT_BUSY;
+                          Sys_Periph_Clock_Put(SYS_PERIPH_USART6);
                           ReturnCode = ANSWERED_REQUEST;
                         }
                         if (UART6_Control.Receive_Counter > 0) {
@@ -720,6 +743,7 @@ ReturnCode_t UART_ReceiveData(uint8_t ID, uint8_t * RecBuffer, uint32_t RecMaxSi
                             //memcpy(UART_DeviceList[ID].Rx_Buffer + 2, UART6_Control.Receive_Buffer, UART6_Control.Receive_Counter);
                             UART_DeviceList[ID].State = UART_STATE_IDLE;
                             UART6_Control.Locked_ID = UART_NOT_BUSY;
+                            Sys_Periph_Clock_Put(SYS_PERIPH_USART6);
                             ReturnCode = ANSWERED_REQUEST;
                           }
                         }
@@ -132,5 +132,88 @@ standard names. */
 //#define EDF_SCHD                                                  EDF_SCHD_RAND
 #define MS_SCHD                                                    MS_SCHD_FAIR
 
+/* 1: EDF kernel driven by the TIM5 one shot release timer, no periodic tick */
+#define MS_TICKLESS                                                0
+
+/* Admission test at task creation: MS_ADMISSION_OFF, _MARGIN or _REJECT.
+ * The demo set of main.c (ES task included) is above U = 1, so only the
+ * margin is reported in MsAdmission.                                       */
+#define MS_ADMISSION_CONTROL                                       MS_ADMISSION_MARGIN
+
+/* 1: Constant Bandwidth Server for aperiodic (ISR) requests, tick mode only */
+#define MS_CBS                                                     0
+
+/* WCET budget enforcement: MS_OVERRUN_OFF, _COUNT, _ABORT, _BACKGROUND or
+ * _SKIP. An aborted job restarts its task function from the entry.         */
+#define MS_OVERRUN_POLICY                                          MS_OVERRUN_OFF
+
+/* 1: the ES task sleeps on the EDF slack (SlackComputation) instead of only
+ * up to the next release. Overhead per call in MsSlackStats.               */
+#define MS_SLACK_STEALING                                          1
+
+/* 1: scale the CPU clock over the PLL levels of Sys_Clock_Table (168, 120,
+ * 84 and 48 MHz). With MS_SLACK_STEALING the ES task weighs sleeping against
+ * running slower for each slack interval, else cycle-conserving EDF.       */
+#define MS_DVFS                                                    0
+
+/* 1: measure the SLEEP/STOP latencies at boot (RTC reference) and derive the
+ * break even times and the STOP wake up compensation from them (MsLpCalib) */
+#define MS_LP_CALIBRATION                                          1
+
+/* 1: slacks above MS_LP_RTC_MIN_TICKS (98) sleep in STOP until the RTC wakeup
+ * timer instead of being cut to the 98 ticks of a SysTick reload         */
+#define MS_LP_RTC_WAKE                                             1
+
+/* 1: after STOP the kernel restarts on the HSI and the switch to the PLL is
+ * waited for by the first job only (wake up latencies in MsLpWake)         */
+#define MS_LP_FAST_WAKE                                            1
+
+/* 1: idle windows above MsLpCalib.BetStandby end in Standby; the EDF state is
+ * checkpointed to the backup SRAM and main() restores it (MsFreeRTOS_WarmBoot) */
+#define MS_STANDBY                                                 0
+
+/* 1: the ES task sleep decision is taken by the kernel (vTaskSwitchContext
+ * and tick) and the ES task runs on the idle task stack, not in Es_Func.
+ * Needs MS_LP_RTC_WAKE 0. Latencies of both modes in MsEsStats.            */
+#define MS_ES_INLINE                                               0
+
+/* 1: releases that come during a sleep wait up to the procrastination interval
+ * (1 - U).T of their task to merge the idle windows. Needs the admission
+ * test; the demo set is above U = 1, so the intervals are 0. Most useful
+ * without MS_SLACK_STEALING, which sleeps on the slack already.            */
+#define MS_PROCRASTINATION                                         0
+
+/* 1: time in RUN, SLEEP and STOP, transitions, STOP wake up latency and per
+ * task active cycles, with the energy of the power model (MsEnergyStats,
+ * MsFreeRTOS_EnergyReport). Cheap enough to be left on.                    */
+#define MS_ENERGY                                                  1
+
+/* 1: the RCC clock of a peripheral is on only while a released job of a task
+ * that declared it (MsFreeRTOS_TaskUsesPeripheral) or a driver transfer needs
+ * it. The drivers are built with SYS_PERIPH_GATING 1.                      */
+#define MS_PERIPH_GATING                                           0
+
+/* 1: DWT cycles of the tick, of the context switch and of the job releases
+ * (count, worst and total in MsOverheadStats)                             */
+#define MS_OVERHEAD_STATS                                          0
+
+/* 1: per task response time, execution time and release jitter (min, max,
+ * mean, log2 histogram), read with MsFreeRTOS_GetJobStats()               */
+#define MS_JOB_STATS                                               0
+
+/* 1: SystemView events for the job releases, ends, preemptions and misses,
+ * the low power entries and exits and the clock restores (module ESEDF).
+ * main() starts SystemView and registers the module.                      */
+#define MS_SYSVIEW                                                 0
+
+/* 1: binary trace ring of the jobs, of the overheads and of the low power
+ * modes (MS_TRACE_SIZE records), read by MsFreeRTOS_TraceRead() and
+ * decoded on the host by SIM/tracedec.                                    */
+#define MS_TRACE                                                   0
+
+/* 1: MsFreeRTOS_CreateJob(), run to completion jobs that share one stack of
+ * MS_JOB_STACK_SIZE words instead of a stack per task                     */
+#define MS_JOB_CALLBACK                                            0
+
 #endif /* FREERTOS_CONFIG_H */
 
@@ -46,7 +46,7 @@ typedef struct
 }DelayApp_t;
 
 extern DelayApp_t Ms_delay[];
-extern uint8_t Ms_currentTaskIndex;
+extern uint16_t Ms_currentTaskIndex;
 /*-----------------------------------------------------------
  * MACROS AND DEFINITIONS
  *----------------------------------------------------------*/
@@ -0,0 +1,1189 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the POSIX host
+ * simulation of the STM32F407 (see port_sim.h).
+ *
+ * One host thread runs everything: each task is a ucontext coroutine with its
+ * own host stack, switched by the emulated PendSV. An interrupt is taken when
+ * the code calls into the port (a task executes, the CPU waits, the masks are
+ * lowered) and neither PRIMASK nor BASEPRI masks it; the handlers run on the
+ * stack of the interrupted task, as on the target. All the simulated
+ * interrupts have the kernel priority, so they never nest.
+ *----------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+	#include <x86intrin.h>
+#endif
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "port_sim.h"
+
+#ifndef configSYSTICK_CLOCK_HZ
+	#define configSYSTICK_CLOCK_HZ configCPU_CLOCK_HZ
+#endif
+
+/* Host stack of each task. The FreeRTOS stack only holds the link to it. */
+#ifndef portSIM_STACK_SIZE
+	#define portSIM_STACK_SIZE			( 64 * 1024 )
+#endif
+
+#define portSIM_PS_PER_S				1000000000000ULL
+#define portSIM_NEVER					UINT64_MAX
+
+/* Pending exceptions, in the order they are taken at the same priority. */
+#define portSIM_IRQ_PENDSV				( 1UL << 0UL )
+#define portSIM_IRQ_SYSTICK				( 1UL << 1UL )
+#define portSIM_IRQ_RTC_WKUP			( 1UL << 2UL )
+#define portSIM_IRQ_TIM5				( 1UL << 3UL )
+
+typedef struct SimThread
+{
+	ucontext_t xContext;
+	void *pvStack;
+	StackType_t *pxTopOfStack;			/* The FreeRTOS stack it stands for. */
+	TaskFunction_t pxCode;
+	void *pvParameters;
+	BaseType_t xStarted;				/* pdFALSE until the context first runs. */
+	struct SimThread *pxNext;
+} SimThread_t;
+
+/* The thread of a TCB, from the word pxTopOfStack points to. */
+#define prvSimThreadOf( pxTCB )			( ( SimThread_t * ) **( StackType_t ** ) ( pxTCB ) )
+
+/*
+ * Exception handlers.
+ */
+void xPortSysTickHandler( void );
+extern void RTC_WKUP_IRQHandler( void );
+extern void TIM5_IRQHandler( void );
+
+/*
+ * Setup the timer to generate the tick interrupts.  The implementation in this
+ * file is weak to allow application writers to change the timer used to
+ * generate the tick interrupt (MS_TICKLESS).
+ */
+void vPortSetupTimerInterrupt( void );
+
+/* The TCB of the running task, read as the PendSV handler of the target. */
+extern void * volatile pxCurrentTCB;
+
+static void prvSimThreadEntry( void );
+static void prvSimDispatch( void );
+static void prvSimEnd( BaseType_t xStalled );
+
+/*-----------------------------------------------------------*/
+
+/* Registers and memory of the simulated device (stm32f4xx.h). */
+uint32_t SystemCoreClock = HSI_VALUE;
+SysTick_Type xPortSimSysTick;
+SCB_Type xPortSimScb;
+PWR_TypeDef xPortSimPwr;
+RTC_TypeDef xPortSimRtc;
+uint8_t ucPortSimBkpSram[ 4096 ];
+volatile uint32_t ulPortSimCyccnt;
+volatile uint32_t ulPortSimDwtCtrl;
+volatile uint32_t ulPortSimDemcr;
+
+PortSimPower_t xPortSimPower =
+{
+	3300,		/* SupplyMv */
+	12000,		/* SleepUA at 168MHz */
+	300,		/* StopUA */
+	6000,		/* HsiRunUA */
+	4000,		/* HseRunUA */
+	13,			/* StopExitUs */
+	12,			/* SleepExitCycles */
+	2000,		/* HseStartUs */
+	100,		/* PllLockUs */
+	HSI_VALUE,	/* StopTickHz: HCLK kept on the HSI by the debug STOP option */
+	32768		/* RefHz */
+};
+
+static PortSimStats_t xSimStats;
+
+/* Each task enters its first critical section with the nesting at 0; before
+the scheduler starts the masks are not lowered by a critical section exit. */
+static UBaseType_t uxCriticalNesting = 0xaaaaaaaa;
+
+/* Interrupt state. */
+static uint32_t ulSimPending = 0;
+static uint32_t ulSimPrimask = 0;
+static uint32_t ulSimBasePri = 0;
+static BaseType_t xSimInIsr = pdFALSE;
+static BaseType_t xSimStarted = pdFALSE;
+
+/* Tasks. */
+static SimThread_t *pxSimThreads = NULL;
+static SimThread_t *pxSimCurrent = NULL;
+static void *pvSimStaleStack = NULL;
+static ucontext_t xSimMainContext;
+static ucontext_t xSimScratchContext;
+
+/* Virtual time and power mode. */
+static uint64_t ullSimPs = 0;
+static uint64_t ullSimEndPs = portSIM_NEVER;
+static uint64_t ullSimRunPs = portSIM_NEVER;	/* from the scheduler start */
+static uint8_t ucSimMode = portSIM_RUN;
+static BaseType_t xSimWaking = pdFALSE;
+
+/* Clock tree: HCLK is SYSCLK (AHB prescaler 1). */
+static uint8_t ucSimSysclk = portSIM_SYSCLK_HSI;
+static uint32_t ulSimHclk = HSI_VALUE;
+static uint64_t ullSimHseReadyPs = portSIM_NEVER;
+static uint64_t ullSimPllReadyPs = portSIM_NEVER;
+static uint32_t ulSimPllHz = 0;
+static uint32_t ulSimPllRunUA = 0;
+
+/* Counters: the fraction of an edge is kept as ps x Hz below 1s. */
+static uint64_t ullSimDwtAcc = 0;
+
+static uint64_t ullSimTickAcc = 0;
+static uint32_t ulSimTickLoad = 0;
+static uint32_t ulSimTickVal = 0;
+static uint32_t ulSimTickCtrl = 0;
+static uint32_t ulSimTickFlag = 0;
+static uint32_t ulSimTickValRead = 0;	/* VAL as published. */
+static uint32_t ulSimIcsr = 0;
+
+static uint64_t ullSimRtc = 0;
+static uint64_t ullSimRtcAcc = 0;
+static uint64_t ullSimWakeAt = portSIM_NEVER;
+static uint32_t ulSimWakePeriod = 0;
+
+static uint32_t ulSimTimHz = 0;
+static uint64_t ullSimTim = 0;
+static uint64_t ullSimTimAcc = 0;
+static uint64_t ullSimTimCompare = portSIM_NEVER;
+
+/*-----------------------------------------------------------*/
+
+/* Edges of a ulHz clock in ullPs, the fraction carried in *pullAcc. */
+static uint64_t prvSimCount( uint64_t *pullAcc, uint32_t ulHz, uint64_t ullPs )
+{
+unsigned __int128 x = ( unsigned __int128 ) ullPs * ulHz + *pullAcc;
+
+	*pullAcc = ( uint64_t ) ( x % portSIM_PS_PER_S );
+	return ( uint64_t ) ( x / portSIM_PS_PER_S );
+}
+/*-----------------------------------------------------------*/
+
+/* Time to the ullEdges-th next edge of a ulHz clock. */
+static uint64_t prvSimPsToEdges( uint64_t ullAcc, uint32_t ulHz, uint64_t ullEdges )
+{
+unsigned __int128 x;
+
+	if( ullEdges == 0 )
+	{
+		return 0;
+	}
+
+	x = ( unsigned __int128 ) ullEdges * portSIM_PS_PER_S - ullAcc;
+	x = ( x + ulHz - 1 ) / ulHz;
+
+	return ( x > portSIM_NEVER - 1 ) ? portSIM_NEVER - 1 : ( uint64_t ) x;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Register values the code reads. The reload edge that follows the count to 0
+ * is not seen: the handler of the tick runs after it on the target, and a
+ * write of 0 to VAL is only taken when it is not what VAL reads.
+ */
+static void prvSimPublish( void )
+{
+	ulSimIcsr = 0;
+	if( ulSimPending & portSIM_IRQ_SYSTICK )
+	{
+		ulSimIcsr |= SCB_ICSR_PENDSTSET_Msk;
+	}
+	if( ulSimPending & portSIM_IRQ_PENDSV )
+	{
+		ulSimIcsr |= SCB_ICSR_PENDSVSET_Msk;
+	}
+
+	ulSimTickValRead = ulSimTickVal;
+	if( ulSimTickVal == 0 && ( ulSimTickCtrl & SysTick_CTRL_ENABLE_Msk ) )
+	{
+		ulSimTickValRead = ulSimTickLoad;
+	}
+
+	xPortSimScb.ICSR = ulSimIcsr;
+	xPortSimSysTick.LOAD = ulSimTickLoad;
+	xPortSimSysTick.VAL = ulSimTickValRead;
+	xPortSimSysTick.CTRL = ulSimTickCtrl | ( ulSimTickFlag ? SysTick_CTRL_COUNTFLAG_Msk : 0 );
+	ulPortSimCyccnt = ( uint32_t ) xSimStats.Cycles;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Take the register write done since the last call into the port. Every
+ * access to the SysTick or the SCB goes through the port first
+ * (pxPortSimSysTick, pxPortSimScb), so a sequence of writes is taken one by
+ * one, in order. A write of what the register reads changes nothing on the
+ * target either: the ICSR reads the pending state, not the SET and CLR bits.
+ */
+static void prvSimSync( void )
+{
+uint32_t ulCtrl = xPortSimSysTick.CTRL & ~SysTick_CTRL_COUNTFLAG_Msk;
+uint32_t ulIcsr = xPortSimScb.ICSR;
+
+	ulSimTickLoad = xPortSimSysTick.LOAD & SysTick_LOAD_RELOAD_Msk;
+
+	/* Any write clears the counter and the count flag. */
+	if( xPortSimSysTick.VAL != ulSimTickValRead )
+	{
+		ulSimTickVal = 0;
+		ulSimTickFlag = 0;
+	}
+
+	if( ulCtrl != ulSimTickCtrl )
+	{
+		if( ( ulSimTickCtrl & SysTick_CTRL_ENABLE_Msk ) == 0 )
+		{
+			ullSimTickAcc = 0;
+		}
+		ulSimTickCtrl = ulCtrl;
+		ulSimTickFlag = 0;
+	}
+
+	if( ulIcsr != ulSimIcsr )
+	{
+		if( ulIcsr & SCB_ICSR_PENDSTCLR_Msk )
+		{
+			ulSimPending &= ~portSIM_IRQ_SYSTICK;
+		}
+		else if( ulIcsr & SCB_ICSR_PENDSTSET_Msk )
+		{
+			ulSimPending |= portSIM_IRQ_SYSTICK;
+		}
+
+		if( ulIcsr & SCB_ICSR_PENDSVCLR_Msk )
+		{
+			ulSimPending &= ~portSIM_IRQ_PENDSV;
+		}
+		else if( ulIcsr & SCB_ICSR_PENDSVSET_Msk )
+		{
+			ulSimPending |= portSIM_IRQ_PENDSV;
+		}
+	}
+
+	prvSimPublish();
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSimTickHz( void )
+{
+	if( ( ulSimTickCtrl & SysTick_CTRL_ENABLE_Msk ) == 0 )
+	{
+		return 0;
+	}
+
+	if( ucSimMode == portSIM_STOP )
+	{
+		return xPortSimPower.StopTickHz;
+	}
+
+	return ( ulSimTickCtrl & SysTick_CTRL_CLKSOURCE_Msk ) ? ulSimHclk : ulSimHclk / 8;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvSimTickEdges( void )
+{
+	if( ulSimTickVal != 0 )
+	{
+		return ulSimTickVal;
+	}
+
+	return ( ulSimTickLoad != 0 ) ? ( uint64_t ) ulSimTickLoad + 1 : portSIM_NEVER;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimTickCount( uint64_t ullEdges )
+{
+	while( ullEdges > 0 )
+	{
+		if( ulSimTickVal == 0 )
+		{
+			/* Reload edge. */
+			if( ulSimTickLoad == 0 )
+			{
+				return;
+			}
+			ulSimTickVal = ulSimTickLoad;
+			ullEdges--;
+		}
+		else if( ullEdges < ulSimTickVal )
+		{
+			ulSimTickVal -= ( uint32_t ) ullEdges;
+			ullEdges = 0;
+		}
+		else
+		{
+			ullEdges -= ulSimTickVal;
+			ulSimTickVal = 0;
+			ulSimTickFlag = 1;
+			if( ulSimTickCtrl & SysTick_CTRL_TICKINT_Msk )
+			{
+				ulSimPending |= portSIM_IRQ_SYSTICK;
+			}
+
+			/* Whole periods only set what is already set. */
+			if( ulSimTickLoad != 0 )
+			{
+				ullEdges %= ( uint64_t ) ulSimTickLoad + 1;
+			}
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSimRunUA( void )
+{
+	switch( ucSimSysclk )
+	{
+		case portSIM_SYSCLK_HSE : return xPortSimPower.HseRunUA;
+		case portSIM_SYSCLK_PLL : return ulSimPllRunUA;
+		default : return xPortSimPower.HsiRunUA;
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* Time to the next event of the current mode. */
+static uint64_t prvSimNextEventPs( void )
+{
+uint64_t ullNext = portSIM_NEVER, ullPs, ullEdges;
+uint32_t ulHz;
+
+	ulHz = prvSimTickHz();
+	ullEdges = prvSimTickEdges();
+	if( ulHz != 0 && ullEdges != portSIM_NEVER && ( ulSimTickCtrl & SysTick_CTRL_TICKINT_Msk ) )
+	{
+		ullNext = prvSimPsToEdges( ullSimTickAcc, ulHz, ullEdges );
+	}
+
+	if( ullSimWakeAt != portSIM_NEVER )
+	{
+		ullPs = prvSimPsToEdges( ullSimRtcAcc, xPortSimPower.RefHz, ullSimWakeAt - ullSimRtc );
+		if( ullPs < ullNext )
+		{
+			ullNext = ullPs;
+		}
+	}
+
+	if( ulSimTimHz != 0 && ucSimMode != portSIM_STOP && ullSimTimCompare != portSIM_NEVER )
+	{
+		ullPs = prvSimPsToEdges( ullSimTimAcc, ulSimTimHz, ullSimTimCompare - ullSimTim );
+		if( ullPs < ullNext )
+		{
+			ullNext = ullPs;
+		}
+	}
+
+	if( xSimStarted != pdFALSE && ullSimEndPs != portSIM_NEVER )
+	{
+		ullPs = ( ullSimEndPs > ullSimPs ) ? ullSimEndPs - ullSimPs : 0;
+		if( ullPs < ullNext )
+		{
+			ullNext = ullPs;
+		}
+	}
+
+	return ullNext;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimAdvance( uint64_t ullPs )
+{
+uint32_t ulHz;
+double dUA, dUj;
+
+	/* Energy of the interval. */
+	switch( ucSimMode )
+	{
+		case portSIM_SLEEP :
+			dUA = ( double ) xPortSimPower.SleepUA * ulSimHclk / 168000000.0;
+			break;
+		case portSIM_STOP :
+			dUA = ( xSimWaking != pdFALSE ) ? xPortSimPower.HsiRunUA : xPortSimPower.StopUA;
+			break;
+		default :
+			dUA = prvSimRunUA();
+			break;
+	}
+	dUj = ( double ) xPortSimPower.SupplyMv * dUA * ( double ) ullPs * 1e-15;
+
+	if( xSimWaking != pdFALSE )
+	{
+		xSimStats.WakePs += ullPs;
+		xSimStats.WakeUj += dUj;
+	}
+	else
+	{
+		xSimStats.Ps[ ucSimMode ] += ullPs;
+		xSimStats.Uj[ ucSimMode ] += dUj;
+	}
+
+	/* Clocks. */
+	if( ucSimMode != portSIM_STOP )
+	{
+		xSimStats.Cycles += prvSimCount( &ullSimDwtAcc, ulSimHclk, ullPs );
+	}
+
+	ulHz = prvSimTickHz();
+	if( ulHz != 0 )
+	{
+		prvSimTickCount( prvSimCount( &ullSimTickAcc, ulHz, ullPs ) );
+	}
+
+	ullSimRtc += prvSimCount( &ullSimRtcAcc, xPortSimPower.RefHz, ullPs );
+	if( ullSimRtc >= ullSimWakeAt )
+	{
+		RTC->ISR |= RTC_ISR_WUTF;
+		ulSimPending |= portSIM_IRQ_RTC_WKUP;
+		while( ullSimWakeAt <= ullSimRtc )
+		{
+			ullSimWakeAt += ulSimWakePeriod;
+		}
+	}
+
+	if( ulSimTimHz != 0 && ucSimMode != portSIM_STOP )
+	{
+		ullSimTim += prvSimCount( &ullSimTimAcc, ulSimTimHz, ullPs );
+		if( ullSimTim >= ullSimTimCompare )
+		{
+			ullSimTimCompare = portSIM_NEVER;
+			ulSimPending |= portSIM_IRQ_TIM5;
+		}
+	}
+
+	ullSimPs += ullPs;
+	prvSimPublish();
+
+	if( xSimStarted != pdFALSE && ullSimPs >= ullSimEndPs )
+	{
+		prvSimEnd( pdFALSE );
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* Up to ullMaxPs, stopping at the next event. The writes are taken before
+the time moves, also in an interrupt handler or before the scheduler starts. */
+static uint64_t prvSimStep( uint64_t ullMaxPs )
+{
+uint64_t ullPs;
+
+	prvSimSync();
+	ullPs = prvSimNextEventPs();
+
+	if( ullMaxPs < ullPs )
+	{
+		ullPs = ullMaxPs;
+	}
+
+	prvSimAdvance( ullPs );
+
+	return ullPs;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimWait( uint64_t ullPs )
+{
+	while( ullPs > 0 )
+	{
+		ullPs -= prvSimStep( ullPs );
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* A pending interrupt ends WFI unless BASEPRI masks it (PRIMASK does not). */
+static BaseType_t prvSimWakeable( void )
+{
+	return ( ulSimPending != 0 && ulSimBasePri == 0 ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimSleep( uint8_t ucMode )
+{
+uint64_t ullStartPs;
+
+	prvSimSync();
+
+	if( prvSimWakeable() != pdFALSE )
+	{
+		return;
+	}
+
+	ucSimMode = ucMode;
+	xSimStats.Entries[ ucMode ]++;
+	ullStartPs = ullSimPs;
+
+	while( prvSimWakeable() == pdFALSE )
+	{
+		if( prvSimNextEventPs() == portSIM_NEVER )
+		{
+			prvSimEnd( pdTRUE );
+		}
+		( void ) prvSimStep( portSIM_NEVER );
+	}
+
+	if( ullSimPs - ullStartPs > xSimStats.MaxPs[ ucMode ] )
+	{
+		xSimStats.MaxPs[ ucMode ] = ullSimPs - ullStartPs;
+	}
+
+	if( ucMode == portSIM_STOP )
+	{
+		/* Regulator, flash and HSI wake up. STOP turned the HSE and the PLL
+		off, SYSCLK is the HSI. */
+		xSimWaking = pdTRUE;
+		prvSimWait( ( uint64_t ) xPortSimPower.StopExitUs * 1000000ULL );
+		xSimWaking = pdFALSE;
+
+		ullSimHseReadyPs = portSIM_NEVER;
+		ullSimPllReadyPs = portSIM_NEVER;
+		ucSimSysclk = portSIM_SYSCLK_HSI;
+		ulSimHclk = HSI_VALUE;
+	}
+	else
+	{
+		prvSimWait( prvSimPsToEdges( ullSimDwtAcc, ulSimHclk, xPortSimPower.SleepExitCycles ) );
+	}
+
+	ucSimMode = portSIM_RUN;
+	xSimStats.Entries[ portSIM_RUN ]++;
+	prvSimPublish();
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimFreeStaleStack( void )
+{
+	if( pvSimStaleStack != NULL )
+	{
+		free( pvSimStaleStack );
+		pvSimStaleStack = NULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* The running thread keeps its stack until it is left. */
+static void prvSimDropStack( SimThread_t *pxThread )
+{
+	if( pxThread == pxSimCurrent )
+	{
+		prvSimFreeStaleStack();
+		pvSimStaleStack = pxThread->pvStack;
+	}
+	else
+	{
+		free( pxThread->pvStack );
+	}
+	pxThread->pvStack = NULL;
+}
+/*-----------------------------------------------------------*/
+
+/* PendSV: the kernel picks the task, the port switches the host context. */
+static void prvSimSwitch( void )
+{
+SimThread_t *pxFrom = pxSimCurrent, *pxTo;
+uint32_t ulBasePri;
+
+	xSimInIsr = pdTRUE;
+	ulBasePri = ulPortRaiseBASEPRI();
+	vTaskSwitchContext();
+	vPortSetBASEPRI( ulBasePri );
+	xSimInIsr = pdFALSE;
+
+	pxTo = prvSimThreadOf( pxCurrentTCB );
+
+	/* A task restarted from its entry (MsRestart) has a new context even when
+	it is selected again. */
+	if( pxTo != pxFrom || pxFrom->xStarted == pdFALSE )
+	{
+		xSimStats.Switches++;
+		pxSimCurrent = pxTo;
+		swapcontext( ( pxFrom->xStarted != pdFALSE ) ? &pxFrom->xContext : &xSimScratchContext, &pxTo->xContext );
+		prvSimFreeStaleStack();
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Take the pending interrupts that are not masked. Only called from thread
+ * mode: the interrupts of the kernel priority do not preempt each other. On
+ * the return to thread mode with SLEEPONEXIT set the CPU sleeps again.
+ */
+static void prvSimDispatch( void )
+{
+BaseType_t xReturn = pdFALSE;
+
+	if( xSimInIsr != pdFALSE || xSimStarted == pdFALSE )
+	{
+		return;
+	}
+
+	for( ;; )
+	{
+		prvSimSync();
+
+		if( ( ulSimPrimask | ulSimBasePri ) != 0 )
+		{
+			return;
+		}
+
+		if( ulSimPending == 0 )
+		{
+			if( xReturn == pdFALSE || ( xPortSimScb.SCR & SCB_SCR_SLEEPONEXIT_Msk ) == 0 )
+			{
+				return;
+			}
+			prvSimSleep( ( xPortSimScb.SCR & SCB_SCR_SLEEPDEEP_Msk ) ? portSIM_STOP : portSIM_SLEEP );
+			continue;
+		}
+
+		xReturn = pdTRUE;
+
+		if( ulSimPending & portSIM_IRQ_PENDSV )
+		{
+			ulSimPending &= ~portSIM_IRQ_PENDSV;
+			prvSimPublish();
+			prvSimSwitch();
+			continue;
+		}
+
+		xSimInIsr = pdTRUE;
+		if( ulSimPending & portSIM_IRQ_SYSTICK )
+		{
+			ulSimPending &= ~portSIM_IRQ_SYSTICK;
+			prvSimPublish();
+			xPortSysTickHandler();
+		}
+		else if( ulSimPending & portSIM_IRQ_RTC_WKUP )
+		{
+			ulSimPending &= ~portSIM_IRQ_RTC_WKUP;
+			prvSimPublish();
+			RTC_WKUP_IRQHandler();
+		}
+		else
+		{
+			ulSimPending &= ~portSIM_IRQ_TIM5;
+			prvSimPublish();
+			TIM5_IRQHandler();
+		}
+		xSimInIsr = pdFALSE;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimEnd( BaseType_t xStalled )
+{
+	if( xSimStarted == pdFALSE )
+	{
+		fprintf( stderr, "sim: the CPU sleeps with no wake up source before the scheduler starts\n" );
+		exit( EXIT_FAILURE );
+	}
+
+	xSimStats.Stalled = ( uint8_t ) xStalled;
+	xSimStarted = pdFALSE;
+	setcontext( &xSimMainContext );
+}
+/*-----------------------------------------------------------*/
+
+static SimThread_t *prvSimFindThread( StackType_t *pxTopOfStack )
+{
+SimThread_t *pxThread;
+
+	for( pxThread = pxSimThreads; pxThread != NULL; pxThread = pxThread->pxNext )
+	{
+		if( pxThread->pxTopOfStack == pxTopOfStack )
+		{
+			break;
+		}
+	}
+
+	return pxThread;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+SimThread_t *pxThread = prvSimFindThread( pxTopOfStack );
+
+	if( pxThread == NULL )
+	{
+		pxThread = calloc( 1, sizeof( SimThread_t ) );
+		configASSERT( pxThread );
+		pxThread->pxTopOfStack = pxTopOfStack;
+		pxThread->pxNext = pxSimThreads;
+		pxSimThreads = pxThread;
+	}
+	else
+	{
+		/* The task starts again from its entry. */
+		prvSimDropStack( pxThread );
+	}
+
+	pxThread->pvStack = malloc( portSIM_STACK_SIZE );
+	configASSERT( pxThread->pvStack );
+	pxThread->pxCode = pxCode;
+	pxThread->pvParameters = pvParameters;
+	pxThread->xStarted = pdFALSE;
+
+	getcontext( &pxThread->xContext );
+	pxThread->xContext.uc_stack.ss_sp = pxThread->pvStack;
+	pxThread->xContext.uc_stack.ss_size = portSIM_STACK_SIZE;
+	pxThread->xContext.uc_link = NULL;
+	makecontext( &pxThread->xContext, prvSimThreadEntry, 0 );
+
+	*pxTopOfStack = ( StackType_t ) pxThread;
+
+	return pxTopOfStack;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSimThreadEntry( void )
+{
+SimThread_t *pxThread = pxSimCurrent;
+
+	pxThread->xStarted = pdTRUE;
+	prvSimFreeStaleStack();
+
+	/* As after the exception return into a new task: interrupts enabled. */
+	prvSimDispatch();
+
+	pxThread->pxCode( pxThread->pvParameters );
+
+	/* A task must not return from its implementing function. */
+	fprintf( stderr, "sim: a task returned from its function\n" );
+	abort();
+}
+/*-----------------------------------------------------------*/
+
+void vPortCleanUpTCB( void *pxTCB )
+{
+StackType_t *pxTopOfStack = *( StackType_t ** ) pxTCB;
+SimThread_t **ppxThread, *pxThread;
+
+	for( ppxThread = &pxSimThreads; *ppxThread != NULL; ppxThread = &( *ppxThread )->pxNext )
+	{
+		if( ( *ppxThread )->pxTopOfStack == pxTopOfStack )
+		{
+			pxThread = *ppxThread;
+			*ppxThread = pxThread->pxNext;
+			prvSimDropStack( pxThread );
+			free( pxThread );
+			break;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+BaseType_t xPortStartScheduler( void )
+{
+	vPortSetupTimerInterrupt();
+	xSimStats.StartPs = ullSimPs;
+	ullSimEndPs = ( ullSimRunPs != portSIM_NEVER ) ? ullSimPs + ullSimRunPs : portSIM_NEVER;
+
+	/* Initialise the critical nesting count ready for the first task. */
+	uxCriticalNesting = 0;
+
+	/* The first task starts with the interrupts enabled. */
+	ulSimPrimask = 0;
+	ulSimBasePri = 0;
+	xSimStarted = pdTRUE;
+	prvSimSync();
+
+	pxSimCurrent = prvSimThreadOf( pxCurrentTCB );
+	swapcontext( &xSimMainContext, &pxSimCurrent->xContext );
+
+	/* vTaskEndScheduler(), the end time or a stall. */
+	return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	if( xSimStarted != pdFALSE )
+	{
+		prvSimEnd( pdFALSE );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+	prvSimSync();
+	ulSimPending |= portSIM_IRQ_PENDSV;
+	prvSimPublish();
+	prvSimDispatch();
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	( void ) ulPortRaiseBASEPRI();
+	uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	configASSERT( uxCriticalNesting );
+	uxCriticalNesting--;
+	if( uxCriticalNesting == 0 )
+	{
+		vPortSetBASEPRI( 0 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulPortRaiseBASEPRI( void )
+{
+uint32_t ulOriginalBASEPRI = ulSimBasePri;
+
+	ulSimBasePri = configMAX_SYSCALL_INTERRUPT_PRIORITY;
+	return ulOriginalBASEPRI;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSetBASEPRI( uint32_t ulNewMaskValue )
+{
+	ulSimBasePri = ulNewMaskValue;
+	prvSimDispatch();
+}
+/*-----------------------------------------------------------*/
+
+void xPortSysTickHandler( void )
+{
+	/* The SysTick runs at the lowest interrupt priority, so when this interrupt
+	executes all interrupts must be unmasked.  There is therefore no need to
+	save and then restore the interrupt mask value as its value is already
+	known. */
+	( void ) ulPortRaiseBASEPRI();
+	{
+		xSimStats.Ticks++;
+
+		/* Increment the RTOS tick. */
+		if( xTaskIncrementTick() != pdFALSE )
+		{
+			/* A context switch is required.  Context switching is performed in
+			the PendSV interrupt.  Pend the PendSV interrupt. */
+			prvSimSync();
+			ulSimPending |= portSIM_IRQ_PENDSV;
+			prvSimPublish();
+		}
+	}
+	vPortSetBASEPRI( 0 );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Setup the systick timer to generate the tick interrupts at the required
+ * frequency.
+ */
+__attribute__(( weak )) void vPortSetupTimerInterrupt( void )
+{
+	/* Stop and clear the SysTick. */
+	SysTick->CTRL = 0UL;
+	SysTick->VAL = 0UL;
+
+	/* Configure SysTick to interrupt at the requested rate. */
+	SysTick->LOAD = ( configSYSTICK_CLOCK_HZ / configTICK_RATE_HZ ) - 1UL;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+/*-----------------------------------------------------------*/
+
+/* Core intrinsics of stm32f4xx.h. */
+void __enable_irq( void )
+{
+	ulSimPrimask = 0;
+	prvSimDispatch();
+}
+
+void __disable_irq( void )
+{
+	ulSimPrimask = 1;
+}
+
+uint32_t __get_PRIMASK( void )
+{
+	return ulSimPrimask;
+}
+
+void __set_PRIMASK( uint32_t priMask )
+{
+	ulSimPrimask = priMask & 1UL;
+	prvSimDispatch();
+}
+
+uint32_t __get_BASEPRI( void )
+{
+	return ulSimBasePri;
+}
+
+void __set_BASEPRI( uint32_t basePri )
+{
+	vPortSetBASEPRI( basePri & 0xFFUL );
+}
+
+void __WFI( void )
+{
+	prvSimSync();
+	if( ( xPortSimScb.SCR & SCB_SCR_SLEEPDEEP_Msk ) && ( PWR->CR & PWR_CR_PDDS ) )
+	{
+		vPortSimStandby();
+	}
+
+	prvSimSleep( ( xPortSimScb.SCR & SCB_SCR_SLEEPDEEP_Msk ) ? portSIM_STOP : portSIM_SLEEP );
+	prvSimDispatch();
+}
+/*-----------------------------------------------------------*/
+
+/* Simulation interface (port_sim.h). */
+SysTick_Type *pxPortSimSysTick( void )
+{
+	prvSimSync();
+	return &xPortSimSysTick;
+}
+/*-----------------------------------------------------------*/
+
+SCB_Type *pxPortSimScb( void )
+{
+	prvSimSync();
+	return &xPortSimScb;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimExecute( uint32_t ulCycles )
+{
+uint64_t ullLeft = ulCycles, ullStart;
+
+	prvSimDispatch();
+
+	while( ullLeft > 0 )
+	{
+		ullStart = xSimStats.Cycles;
+		( void ) prvSimStep( prvSimPsToEdges( ullSimDwtAcc, ulSimHclk, ullLeft ) );
+		ullLeft -= xSimStats.Cycles - ullStart;
+
+		/* Preempted here by what came meanwhile. */
+		prvSimDispatch();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimSetEndTime( uint64_t ullUs )
+{
+	ullSimRunPs = ( ullUs != 0 ) ? ullUs * 1000000ULL : portSIM_NEVER;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t ullPortSimTimePs( void )
+{
+	return ullSimPs;
+}
+/*-----------------------------------------------------------*/
+
+const PortSimStats_t *pxPortSimStats( void )
+{
+	return &xSimStats;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulPortSimHostCycles( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+	return ( uint32_t ) __rdtsc();
+#else
+	struct timespec xNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return ( uint32_t ) ( ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec );
+#endif
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimHseEnable( void )
+{
+	if( ullSimHseReadyPs == portSIM_NEVER )
+	{
+		ullSimHseReadyPs = ullSimPs + ( uint64_t ) xPortSimPower.HseStartUs * 1000000ULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+uint8_t ucPortSimHseReady( void )
+{
+	return ( ullSimPs >= ullSimHseReadyPs ) ? 1 : 0;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimPllEnable( uint32_t ulHz, uint32_t ulRunUA )
+{
+	configASSERT( ullSimHseReadyPs != portSIM_NEVER );
+
+	ulSimPllHz = ulHz;
+	ulSimPllRunUA = ulRunUA;
+	if( ullSimPllReadyPs == portSIM_NEVER )
+	{
+		ullSimPllReadyPs = ( ( ullSimPs > ullSimHseReadyPs ) ? ullSimPs : ullSimHseReadyPs ) + ( uint64_t ) xPortSimPower.PllLockUs * 1000000ULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimPllDisable( void )
+{
+	configASSERT( ucSimSysclk != portSIM_SYSCLK_PLL );
+	ullSimPllReadyPs = portSIM_NEVER;
+}
+/*-----------------------------------------------------------*/
+
+uint8_t ucPortSimPllReady( void )
+{
+	return ( ullSimPs >= ullSimPllReadyPs ) ? 1 : 0;
+}
+/*-----------------------------------------------------------*/
+
+/* A wait loop of the Sys_* functions runs to the event in one step. */
+uint32_t ulPortSimCyclesToReady( void )
+{
+uint64_t ullReadyPs = portSIM_NEVER, ullCycles;
+
+	if( ullSimHseReadyPs > ullSimPs )
+	{
+		ullReadyPs = ullSimHseReadyPs;
+	}
+	if( ullSimPllReadyPs > ullSimPs && ullSimPllReadyPs < ullReadyPs )
+	{
+		ullReadyPs = ullSimPllReadyPs;
+	}
+	if( ullReadyPs == portSIM_NEVER )
+	{
+		return 0;
+	}
+
+	ullCycles = ( ( unsigned __int128 ) ( ullReadyPs - ullSimPs ) * ulSimHclk + portSIM_PS_PER_S - 1 ) / portSIM_PS_PER_S;
+
+	return ( ullCycles > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) ullCycles;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimSysclk( uint8_t ucSource )
+{
+	switch( ucSource )
+	{
+		case portSIM_SYSCLK_HSE :
+			configASSERT( ucPortSimHseReady() );
+			ulSimHclk = HSE_VALUE;
+			break;
+		case portSIM_SYSCLK_PLL :
+			configASSERT( ucPortSimPllReady() );
+			ulSimHclk = ulSimPllHz;
+			break;
+		default :
+			ulSimHclk = HSI_VALUE;
+			break;
+	}
+	ucSimSysclk = ucSource;
+}
+/*-----------------------------------------------------------*/
+
+uint8_t ucPortSimSysclkSource( void )
+{
+	return ucSimSysclk;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t ullPortSimRtcCounts( void )
+{
+	return ullSimRtc;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimRtcWakeup( uint32_t ulCounts )
+{
+	prvSimSync();
+
+	ulSimWakePeriod = ulCounts;
+	ullSimWakeAt = ( ulCounts != 0 ) ? ullSimRtc + ulCounts : portSIM_NEVER;
+	ulSimPending &= ~portSIM_IRQ_RTC_WKUP;
+	prvSimPublish();
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimKernelTimerStart( uint32_t ulTickHz )
+{
+	ulSimTimHz = ulTickHz;
+	ullSimTim = 0;
+	ullSimTimAcc = 0;
+	ullSimTimCompare = portSIM_NEVER;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t ullPortSimKernelTimerGet( void )
+{
+	return ullSimTim;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimKernelTimerArm( uint64_t ullTime )
+{
+	prvSimSync();
+
+	if( ullTime <= ullSimTim )
+	{
+		/* Already passed: the event is generated now. */
+		ullSimTimCompare = portSIM_NEVER;
+		ulSimPending |= portSIM_IRQ_TIM5;
+	}
+	else
+	{
+		ullSimTimCompare = ullTime;
+	}
+	prvSimPublish();
+	prvSimDispatch();
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimStandby( void )
+{
+	fprintf( stderr, "sim: Standby is a reset, it is not simulated\n" );
+	prvSimEnd( pdTRUE );
+}
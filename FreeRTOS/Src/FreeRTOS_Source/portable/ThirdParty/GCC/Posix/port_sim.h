@@ -0,0 +1,121 @@
+/*
+ * Host simulation of the ES-EDF kernel: interface of the POSIX port.
+ *
+ * The kernel, the Ms* EDF code and the ES task run unchanged; what the port
+ * replaces is the Cortex-M4 and the part of the STM32F407 the kernel uses.
+ * Time is virtual and discrete event: it only moves when a task executes
+ * (vPortSimExecute), when the CPU waits for an interrupt (WFI, SLEEP, STOP)
+ * and when a driver waits for the hardware (oscillators, busy waits of the
+ * Sys_* functions). The kernel code itself takes no time, so the overheads
+ * seen by the DWT are the modelled ones only.
+ *
+ *   SysTick   HCLK (or HCLK/8), StopTickHz in STOP (0: stopped)
+ *   DWT       HCLK in RUN and SLEEP
+ *   RTC       RefHz in every mode: reference counter and wakeup timer
+ *   TIM5      kernel timer at TickHz, stopped in STOP
+ *
+ * The energy of each mode is integrated on the simulator side from the power
+ * model, independently of the kernel accounting (MS_ENERGY), so both can be
+ * compared.
+ */
+
+#ifndef PORT_SIM_H
+#define PORT_SIM_H
+
+#include <stdint.h>
+
+/* Power modes of the simulated CPU, in the MS_ENERGY_* order               */
+#define portSIM_RUN                    0
+#define portSIM_SLEEP                  1
+#define portSIM_STOP                   2
+#define portSIM_MODES                  3
+
+/*
+ * Power and timing model. The RUN current comes with each clock setting
+ * (vPortSimSysclk: Sys_Clock_Table[].RunUA for the PLL levels), the SLEEP
+ * current scales with HCLK from its 168MHz figure. The STOP wake up
+ * (StopExitUs) draws HsiRunUA with the timers as in STOP.
+ */
+typedef struct
+{
+  uint32_t SupplyMv;
+  uint32_t SleepUA;          /* SLEEP at 168MHz                               */
+  uint32_t StopUA;           /* STOP, main regulator on                       */
+  uint32_t HsiRunUA;         /* RUN on the HSI (16MHz)                        */
+  uint32_t HseRunUA;         /* RUN on the HSE (8MHz)                         */
+  uint32_t StopExitUs;       /* STOP wake up: regulator, flash and HSI        */
+  uint32_t SleepExitCycles;  /* SLEEP wake up, HCLK cycles                    */
+  uint32_t HseStartUs;       /* HSE start up                                  */
+  uint32_t PllLockUs;        /* PLL lock                                      */
+  uint32_t StopTickHz;       /* SysTick in STOP (debug STOP option), 0: off   */
+  uint32_t RefHz;            /* RTC clock (LSE)                               */
+} PortSimPower_t;
+
+extern PortSimPower_t xPortSimPower;
+
+typedef struct
+{
+  uint64_t Ps[portSIM_MODES];      /* virtual time in each mode               */
+  double   Uj[portSIM_MODES];      /* energy in each mode                     */
+  uint32_t Entries[portSIM_MODES]; /* entries (RUN: wake ups)                 */
+  uint64_t MaxPs[portSIM_MODES];   /* longest SLEEP and STOP                  */
+  uint64_t WakePs;                 /* STOP wake up latency, not in Ps[]       */
+  double   WakeUj;
+  uint64_t Cycles;                 /* DWT cycles, 64 bits                     */
+  uint32_t Switches;               /* PendSV that changed the task            */
+  uint32_t Ticks;                  /* SysTick interrupts                      */
+  uint8_t  Stalled;                /* ended by a sleep with no wake up source */
+  uint64_t StartPs;                /* scheduler start, kernel tick 0          */
+} PortSimStats_t;
+
+/*
+ * The calling task runs ulCycles CPU cycles at the current clock; the
+ * interrupts that come meanwhile preempt it as on the target. This is the
+ * job body of a simulated task (its WCET in cycles).
+ */
+void vPortSimExecute( uint32_t ulCycles );
+
+/* The scheduler ends, vTaskStartScheduler() returns, ullUs of virtual time
+ * after its start, the boot (MS_LP_CALIBRATION) not counted (0: only
+ * vTaskEndScheduler() or a stall ends it)                                   */
+void vPortSimSetEndTime( uint64_t ullUs );
+
+uint64_t ullPortSimTimePs( void );
+const PortSimStats_t *pxPortSimStats( void );
+
+/* Host time stamp counter (x86) or nanoseconds, for the kernel overheads    */
+uint32_t ulPortSimHostCycles( void );
+
+/*
+ * Simulated clock tree and timers, used by the Sys_* driver of the port
+ * (sys_cfg_posix.c). The HCLK is what SYSCLK runs at; SystemCoreClock is
+ * only the software view of it, set by the driver as on the target.
+ */
+#define portSIM_SYSCLK_HSI             0
+#define portSIM_SYSCLK_HSE             1
+#define portSIM_SYSCLK_PLL             2
+
+void    vPortSimHseEnable( void );
+uint8_t ucPortSimHseReady( void );
+void    vPortSimPllEnable( uint32_t ulHz, uint32_t ulRunUA );  /* needs the HSE ready */
+void    vPortSimPllDisable( void );
+uint8_t ucPortSimPllReady( void );
+uint32_t ulPortSimCyclesToReady( void );  /* HCLK cycles to the HSE or PLL started, 0: none */
+void    vPortSimSysclk( uint8_t ucSource );
+uint8_t ucPortSimSysclkSource( void );
+
+/* RTC counts since the start of the simulation (RefHz)                     */
+uint64_t ullPortSimRtcCounts( void );
+/* Periodic RTC wakeup event every ulCounts RTC counts (0: off): RTC_ISR_WUTF
+ * and RTC_WKUP_IRQHandler                                                   */
+void     vPortSimRtcWakeup( uint32_t ulCounts );
+
+/* TIM5: counter at ulTickHz, compare event by TIM5_IRQHandler              */
+void     vPortSimKernelTimerStart( uint32_t ulTickHz );
+uint64_t ullPortSimKernelTimerGet( void );
+void     vPortSimKernelTimerArm( uint64_t ullTime );
+
+/* Standby is a reset: the simulation ends there                            */
+void     vPortSimStandby( void );
+
+#endif /* PORT_SIM_H */
@@ -0,0 +1,173 @@
+/*
+ * Host stand in for the CMSIS device header of the STM32F407, for the POSIX
+ * port. Only what the kernel and the Sys_* interface use is declared: the
+ * registers are plain memory, the core intrinsics are port functions. Each
+ * access to the SysTick or the SCB calls into port.c first, which takes the
+ * write of the access before (no virtual time passes in between).
+ */
+
+#ifndef STM32F4XX_H
+#define STM32F4XX_H
+
+#include <stdint.h>
+
+#define __NVIC_PRIO_BITS               4U
+#define HSI_VALUE                      ((uint32_t)16000000U)
+#define HSE_VALUE                      ((uint32_t)8000000U)
+
+extern uint32_t SystemCoreClock;
+
+typedef enum
+{
+  RESET = 0U,
+  SET = !RESET
+} FlagStatus, ITStatus;
+
+typedef enum
+{
+  SUCCESS = 0U,
+  ERROR = !SUCCESS
+} ErrorStatus;
+
+#define SET_BIT(REG, BIT)              ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)            ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)             ((REG) & (BIT))
+#define WRITE_REG(REG, VAL)            ((REG) = (VAL))
+#define READ_REG(REG)                  ((REG))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK)  WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+
+/* SysTick                                                                   */
+typedef struct
+{
+  volatile uint32_t CTRL;
+  volatile uint32_t LOAD;
+  volatile uint32_t VAL;
+  volatile uint32_t CALIB;
+} SysTick_Type;
+
+#define SysTick_CTRL_ENABLE_Msk        (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk       (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk     (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk     (1UL << 16)
+#define SysTick_LOAD_RELOAD_Msk        (0xFFFFFFUL)
+
+/* System control block                                                      */
+typedef struct
+{
+  volatile uint32_t CPUID;
+  volatile uint32_t ICSR;
+  volatile uint32_t VTOR;
+  volatile uint32_t AIRCR;
+  volatile uint32_t SCR;
+  volatile uint32_t CCR;
+} SCB_Type;
+
+#define SCB_ICSR_PENDSTCLR_Msk         (1UL << 25)
+#define SCB_ICSR_PENDSTSET_Msk         (1UL << 26)
+#define SCB_ICSR_PENDSVCLR_Msk         (1UL << 27)
+#define SCB_ICSR_PENDSVSET_Msk         (1UL << 28)
+#define SCB_SCR_SLEEPONEXIT_Msk        (1UL << 1)
+#define SCB_SCR_SLEEPDEEP_Msk          (1UL << 2)
+
+/* Power control                                                             */
+typedef struct
+{
+  volatile uint32_t CR;
+  volatile uint32_t CSR;
+} PWR_TypeDef;
+
+#define PWR_CR_LPDS                    (1UL << 0)
+#define PWR_CR_PDDS                    (1UL << 1)
+#define PWR_CR_CWUF                    (1UL << 2)
+#define PWR_CR_CSBF                    (1UL << 3)
+#define PWR_CR_DBP                     (1UL << 8)
+#define PWR_CSR_WUF                    (1UL << 0)
+#define PWR_CSR_SBF                    (1UL << 1)
+
+#define PWR_MAINREGULATOR_ON           0x00000000U
+#define PWR_LOWPOWERREGULATOR_ON       PWR_CR_LPDS
+#define PWR_SLEEPENTRY_WFI             ((uint8_t)0x01)
+#define PWR_SLEEPENTRY_WFE             ((uint8_t)0x02)
+#define PWR_STOPENTRY_WFI              ((uint8_t)0x01)
+#define PWR_STOPENTRY_WFE              ((uint8_t)0x02)
+
+/* Real time clock: the wakeup flag only                                     */
+typedef struct
+{
+  volatile uint32_t ISR;
+} RTC_TypeDef;
+
+#define RTC_ISR_WUTF                   (1UL << 10)
+
+extern SysTick_Type xPortSimSysTick;
+extern SCB_Type     xPortSimScb;
+SysTick_Type *pxPortSimSysTick(void);
+SCB_Type     *pxPortSimScb(void);
+extern PWR_TypeDef  xPortSimPwr;
+extern RTC_TypeDef  xPortSimRtc;
+extern uint8_t      ucPortSimBkpSram[4096];
+
+#define SysTick                        (pxPortSimSysTick())
+#define SCB                            (pxPortSimScb())
+#define PWR                            (&xPortSimPwr)
+#define RTC                            (&xPortSimRtc)
+#define BKPSRAM_BASE                   ((uintptr_t)ucPortSimBkpSram)
+
+/* DWT cycle counter (macros.h): HCLK cycles in RUN and SLEEP               */
+extern volatile uint32_t ulPortSimCyccnt;
+extern volatile uint32_t ulPortSimDwtCtrl;
+extern volatile uint32_t ulPortSimDemcr;
+
+#define KIN1_DWT_CONTROL               ulPortSimDwtCtrl
+#define KIN1_DWT_CYCCNTENA_BIT         (1UL<<0)
+#define KIN1_DWT_CYCCNT                ulPortSimCyccnt
+#define KIN1_DEMCR                     ulPortSimDemcr
+#define KIN1_TRCENA_BIT                (1UL<<24)
+
+/* Core intrinsics                                                           */
+void     __enable_irq(void);
+void     __disable_irq(void);
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t priMask);
+uint32_t __get_BASEPRI(void);
+void     __set_BASEPRI(uint32_t basePri);
+void     __WFI(void);
+
+#define __DSB()                        __asm volatile( "" ::: "memory" )
+#define __ISB()                        __asm volatile( "" ::: "memory" )
+#define __NOP()
+
+static inline uint32_t __RBIT(uint32_t value)
+{
+  uint32_t result = 0;
+  uint32_t i;
+
+  for(i = 0; i < 32; i++)
+    if(value & (1UL << i))
+      result |= 1UL << (31 - i);
+
+  return result;
+}
+
+static inline uint8_t __CLZ(uint32_t value)
+{
+  return (value == 0) ? 32 : (uint8_t)__builtin_clz(value);
+}
+
+/* CMSIS SysTick set up: 1 when the reload does not fit                      */
+static inline uint32_t SysTick_Config(uint32_t ticks)
+{
+  if((ticks - 1UL) > SysTick_LOAD_RELOAD_Msk)
+    return 1UL;
+
+  SysTick->LOAD = (uint32_t)(ticks - 1UL);
+  SysTick->VAL  = 0UL;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+  return 0UL;
+}
+
+/* HAL power modes (sys_cfg_posix.c)                                         */
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry);
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry);
+
+#endif /* STM32F4XX_H */
@@ -0,0 +1,392 @@
+/**
+ ******************************************************************************
+ * @file    sys_cfg_posix.c
+ * @brief   sys_cfg_stm32f407.h on the host simulation (POSIX port).
+ *
+ *          The clock, timer and low power functions follow the register
+ *          sequences of sys_cfg_stm32f407.c on the simulated clock tree of
+ *          port_sim.h: a wait for an oscillator or a flag is a loop that runs
+ *          virtual CPU cycles until the hardware is ready, so the kernel sees
+ *          the same latencies as on the board. The RCC clock gating of the
+ *          peripherals is only reference counted.
+ *
+ */
+
+#include <stddef.h>
+
+#include "sys_cfg_stm32f407.h"
+#include "stm32f4xx.h"
+#include "port_sim.h"
+
+/* CPU cycles of one Sys_* call and of one turn of a wait loop */
+#ifndef SYS_SIM_CALL_CYCLES
+#define SYS_SIM_CALL_CYCLES            20
+#endif
+
+#define SYS_SIM_WAIT(Ready)            do { vPortSimExecute(Sys_Sim_Wait_Cycles()); } while(!(Ready))
+
+uint32_t SysTick_Counter;
+
+/* Same levels as the firmware (sys_cfg_stm32f407.c), keep both in step */
+const Sys_Clock_Level_t Sys_Clock_Table[SYS_CLOCK_LEVELS] =
+{
+  /*  Hz         PllN  PllP  PllQ  WS  Vos  RunUA */
+  { 168000000,   168,  2,    7,    5,  1,   46000 },
+  { 120000000,   120,  2,    5,    3,  0,   32000 },
+  {  84000000,   168,  4,    7,    2,  0,   23000 },
+  {  48000000,    96,  4,    4,    1,  0,   14000 },
+};
+
+/* PLL configuration, kept in STOP as on the target */
+static uint8_t Sys_Sim_Level;
+
+/* Clock references of each peripheral */
+static uint8_t Sys_Periph_Refs[SYS_PERIPH_COUNT];
+
+/* Loop turns of a wait to the oscillator the port has starting, at once */
+static uint32_t Sys_Sim_Wait_Cycles(void)
+{
+  uint32_t Turns = (ulPortSimCyclesToReady() + SYS_SIM_CALL_CYCLES - 1) / SYS_SIM_CALL_CYCLES;
+
+  if(Turns == 0)
+    Turns = 1;
+  if(Turns > UINT32_MAX / SYS_SIM_CALL_CYCLES)
+    Turns = UINT32_MAX / SYS_SIM_CALL_CYCLES;
+
+  return Turns * SYS_SIM_CALL_CYCLES;
+}
+
+/* Kernel timer (TIM5) overflow count and compare event callback */
+volatile uint32_t Sys_Kernel_Timer_Overflow;
+void (*Sys_Kernel_Timer_Callback)(void);
+
+void Sys_Enable_Peripherals_Clock(void)
+{
+  vPortSimExecute(SYS_SIM_CALL_CYCLES);
+}
+
+/* Reference on (Get) or off every peripheral of a mask */
+static void Sys_Periph_Clock_Ref_Mask(uint32_t Mask, uint8_t Get)
+{
+  uint32_t Primask = __get_PRIMASK();
+  uint32_t Periph;
+
+  __disable_irq();
+  for(Periph = 0; Mask != 0 && Periph < SYS_PERIPH_COUNT; Periph++, Mask >>= 1)
+  {
+    if((Mask & 1) == 0)
+      continue;
+
+    if(Get)
+      Sys_Periph_Refs[Periph]++;
+    else if(Sys_Periph_Refs[Periph] != 0)
+      Sys_Periph_Refs[Periph]--;
+  }
+  __set_PRIMASK(Primask);
+}
+
+void Sys_Periph_Clock_Get(Sys_Periph_t Periph)
+{
+  Sys_Periph_Clock_Ref_Mask(SYS_PERIPH_BIT(Periph), 1);
+}
+
+void Sys_Periph_Clock_Put(Sys_Periph_t Periph)
+{
+  Sys_Periph_Clock_Ref_Mask(SYS_PERIPH_BIT(Periph), 0);
+}
+
+void Sys_Periph_Clock_Get_Mask(uint32_t Mask)
+{
+  Sys_Periph_Clock_Ref_Mask(Mask, 1);
+}
+
+void Sys_Periph_Clock_Put_Mask(uint32_t Mask)
+{
+  Sys_Periph_Clock_Ref_Mask(Mask, 0);
+}
+
+void Sys_Periph_Clock_Init_Done(Sys_Periph_t Periph)
+{
+#if (SYS_PERIPH_GATING == 1)
+  Sys_Periph_Clock_Put(Periph);
+#else
+  (void)Periph;
+#endif
+}
+
+uint32_t Sys_Periph_Clock_On(void)
+{
+  uint32_t Mask = 0;
+  uint32_t Periph;
+
+  for(Periph = 0; Periph < SYS_PERIPH_COUNT; Periph++)
+  {
+    if(Sys_Periph_Refs[Periph] != 0)
+      Mask |= SYS_PERIPH_BIT(Periph);
+  }
+  return Mask;
+}
+
+void Sys_Configure_Clock_168MHz(void)
+{
+  vPortSimHseEnable();
+  SYS_SIM_WAIT(ucPortSimHseReady());
+
+  Sys_Sim_Level = 0;
+  vPortSimPllEnable(Sys_Clock_Table[0].Hz, Sys_Clock_Table[0].RunUA);
+  SYS_SIM_WAIT(ucPortSimPllReady());
+
+  vPortSimSysclk(portSIM_SYSCLK_PLL);
+
+  SystemCoreClock = 168000000;
+
+  SysTick_Config(168000000 / 1000);
+}
+
+void Sys_Configure_Clock_168MHz_HSI(void)
+{
+  /* The PLL input is not modelled: same as from the HSE */
+  Sys_Configure_Clock_168MHz();
+}
+
+uint32_t Sys_Configure_Clock_Level(uint8_t Level)
+{
+  const Sys_Clock_Level_t *Cfg = &Sys_Clock_Table[Level];
+  uint32_t Hz = SystemCoreClock, Load = SysTick->LOAD, Rest, Hse, Ticks = 0;
+  uint64_t Ns, Wait;
+
+  /* SYSCLK from HSE while the PLL is reconfigured */
+  vPortSimHseEnable();
+  SYS_SIM_WAIT(ucPortSimHseReady());
+  vPortSimSysclk(portSIM_SYSCLK_HSE);
+  Rest = SysTick->VAL;
+
+  vPortSimPllDisable();
+
+  Sys_Sim_Level = Level;
+  vPortSimPllEnable(Cfg->Hz, Cfg->RunUA);
+  SYS_SIM_WAIT(ucPortSimPllReady());
+
+  Hse = SysTick->VAL;
+  vPortSimSysclk(portSIM_SYSCLK_PLL);
+
+  SystemCoreClock = Cfg->Hz;
+
+  /* The rest of the tick in progress at the new rate, less the time at the
+   * HSE rate: the counts down to Hse, plus the old period when the counter
+   * reached 0 meanwhile. A tick that ended during the switch is pending
+   * (set here when the counter did not reach 0) and the next one is shorter
+   * by its delay. Then 1ms ticks */
+  if(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+  {
+    Ns   = (uint64_t)Rest * 1000000000ULL / Hz;
+    Wait = (uint64_t)((Hse <= Rest) ? Rest - Hse : Rest + Load + 1 - Hse) * 1000000000ULL / HSE_VALUE;
+    if(Ns > Wait)
+      Ns -= Wait;
+    else
+    {
+      if(Hse <= Rest)
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+      Ticks = (uint32_t)((Wait - Ns) / 1000000ULL);
+      Ns    = 1000000ULL - (Wait - Ns) % 1000000ULL;
+    }
+    Sys_Tick_Rest((uint32_t)(Ns * SystemCoreClock / 1000000000ULL));
+  }
+  else
+    SysTick->LOAD = (Cfg->Hz / 1000) - 1;
+
+  return Ticks;
+}
+
+uint8_t Sys_Stop_Wake_Begin(void)
+{
+  if(ucPortSimSysclkSource() != portSIM_SYSCLK_HSI)
+    return 0;
+
+  vPortSimHseEnable();
+
+  SystemCoreClock = HSI_VALUE;
+
+  return 1;
+}
+
+uint8_t Sys_Stop_Wake_Ready(void)
+{
+  if(ucPortSimPllReady() == 0)
+  {
+    if(ucPortSimHseReady() == 0)
+      return 0;
+    vPortSimPllEnable(Sys_Clock_Table[Sys_Sim_Level].Hz, Sys_Clock_Table[Sys_Sim_Level].RunUA);
+  }
+
+  return ucPortSimPllReady();
+}
+
+void Sys_Stop_Wake_Finish(uint8_t Level)
+{
+  uint32_t Rest;
+
+  SYS_SIM_WAIT(Sys_Stop_Wake_Ready());
+
+  Rest = SysTick->VAL;
+
+  vPortSimSysclk(portSIM_SYSCLK_PLL);
+
+  SystemCoreClock = Sys_Clock_Table[Level].Hz;
+
+  if(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+  {
+    /* The rest of the tick in progress at the new rate, then 1ms ticks */
+    Sys_Tick_Rest((uint32_t)((uint64_t)Rest * SystemCoreClock / HSI_VALUE));
+  }
+}
+
+void Sys_Tick_Rest(uint32_t Rest)
+{
+  SysTick->LOAD = (Rest < 2) ? 2 : ((Rest > SysTick_LOAD_RELOAD_Msk) ? SysTick_LOAD_RELOAD_Msk : Rest);
+  SysTick->VAL  = 0;
+  /* Not SYS_SIM_WAIT: an oscillator may be starting (Sys_Stop_Wake_Begin) */
+  do { vPortSimExecute(SYS_SIM_CALL_CYCLES); } while(SysTick->VAL == 0);
+  SysTick->LOAD = (SystemCoreClock / 1000) - 1;
+}
+
+void Sys_DeInit_Clock(void)
+{
+
+}
+
+void Sys_Enable_LSE(void)
+{
+  /* The RTC clock is RefHz from the start */
+}
+
+uint32_t Sys_Get_Tick(void)
+{
+  return (SysTick_Counter);
+}
+
+void Sys_Kernel_Timer_Init(uint32_t TickHz, void (*Callback)(void))
+{
+  Sys_Kernel_Timer_Callback = Callback;
+  Sys_Kernel_Timer_Overflow = 0;
+
+  vPortSimKernelTimerStart(TickHz);
+}
+
+uint64_t Sys_Kernel_Timer_Get(void)
+{
+  vPortSimExecute(SYS_SIM_CALL_CYCLES);
+  return ullPortSimKernelTimerGet();
+}
+
+void Sys_Kernel_Timer_Arm(uint64_t Time)
+{
+  vPortSimKernelTimerArm(Time);
+}
+
+void Sys_Lp_Ref_Start(void)
+{
+  vPortSimExecute(SYS_SIM_CALL_CYCLES);
+}
+
+void Sys_Lp_Ref_Stop(void)
+{
+
+}
+
+uint32_t Sys_Lp_Ref_Get(void)
+{
+  uint64_t Counts;
+
+  /* The read of the RTC registers through the APB */
+  vPortSimExecute(SYS_SIM_CALL_CYCLES);
+  Counts = ullPortSimRtcCounts();
+
+  /* Seconds * 32768 + sub-second count, at RefHz */
+  Counts = (Counts / xPortSimPower.RefHz << 15) + ((Counts % xPortSimPower.RefHz) << 15) / xPortSimPower.RefHz;
+
+  return (uint32_t)(Counts % SYS_LP_REF_DAY);
+}
+
+uint32_t Sys_Lp_Ref_Delta(uint32_t From, uint32_t To)
+{
+  if(To >= From)
+    return To - From;
+
+  /* Midnight in between */
+  return To + SYS_LP_REF_DAY - From;
+}
+
+void Sys_Wakeup_Timer_Start(uint32_t Counts)
+{
+  RTC->ISR &= ~RTC_ISR_WUTF;
+
+  /* RTC clock/2, reloaded at each event as on the target */
+  vPortSimRtcWakeup(Counts * 2);
+}
+
+void Sys_Wakeup_Timer_Stop(void)
+{
+  vPortSimRtcWakeup(0);
+  RTC->ISR &= ~RTC_ISR_WUTF;
+}
+
+void Sys_Backup_Sram_Enable(void)
+{
+
+}
+
+void Sys_Enter_Standby(uint32_t Counts)
+{
+  (void)Counts;
+
+  for(;;)
+    vPortSimStandby();
+}
+
+uint8_t Sys_Standby_Resumed(void)
+{
+  return 0;
+}
+
+/**
+ * @brief Kernel timer (TIM5) IRQ: the simulated counter is 64 bits, only the
+ *        compare event is left
+ * @param  None
+ * @retval None
+ */
+void TIM5_IRQHandler(void)
+{
+  if(Sys_Kernel_Timer_Callback != NULL)
+    Sys_Kernel_Timer_Callback();
+}
+
+/**
+ * @brief RTC wakeup timer IRQ: the wake up itself is the event
+ * @param  None
+ * @retval None
+ */
+void RTC_WKUP_IRQHandler(void)
+{
+  RTC->ISR &= ~RTC_ISR_WUTF;
+}
+
+/* HAL power modes, as in stm32f4xx_hal_pwr.c */
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry)
+{
+  (void)Regulator;
+  (void)SLEEPEntry;
+
+  CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+  __WFI();
+}
+
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry)
+{
+  (void)STOPEntry;
+
+  MODIFY_REG(PWR->CR, (PWR_CR_PDDS | PWR_CR_LPDS), Regulator);
+  SET_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+  __WFI();
+  CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+}
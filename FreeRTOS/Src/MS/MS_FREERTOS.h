@@ -13,6 +13,440 @@
  #define MS_SCHD                                                             0
 #endif
 
+/* Admission test run by MsFreeRTOS_CreateTask/CreateEnergySavingTask        */
+#define MS_ADMISSION_OFF                                                     0
+#define MS_ADMISSION_MARGIN                                                  1  /* accept, report the margin */
+#define MS_ADMISSION_REJECT                                                  2  /* refuse a task set that misses */
+
+#ifndef MS_ADMISSION_CONTROL
+ #define MS_ADMISSION_CONTROL                                                0
+#endif
+
+#define errMS_TASK_NOT_SCHEDULABLE                                           ( -10 )
+
+/* Action when a job runs longer than MsWcet (measured with the DWT)         */
+#define MS_OVERRUN_OFF                                                       0  /* no measurement */
+#define MS_OVERRUN_COUNT                                                     1  /* MsOverrun only */
+#define MS_OVERRUN_ABORT                                                     2  /* end the job, restart the task code */
+#define MS_OVERRUN_BACKGROUND                                                3  /* run only when nothing else is ready */
+#define MS_OVERRUN_SKIP                                                      4  /* skip the next release */
+
+#ifndef MS_OVERRUN_POLICY
+ #define MS_OVERRUN_POLICY                                                   0
+#endif
+
+/* Feasibility margin of the task set, updated by every admission test     */
+typedef struct
+{
+  int32_t  UMargin;      /* 1 - U in Q16 (65536 = 100%), < 0 when U > 1      */
+  int32_t  DemandSlack;  /* min t - h(t) over the QPA points, in ticks
+                            (INT32_MAX when all D >= P and QPA is not run)   */
+} MsAdmission_t;
+
+extern MsAdmission_t MsAdmission;
+
+/* 1: the ES task sleeps on the EDF slack (SlackComputation)                */
+#ifndef MS_SLACK_STEALING
+ #define MS_SLACK_STEALING                                                   0
+#endif
+
+/*
+ * 1: the CPU clock follows the load over the levels of Sys_Clock_Table.
+ * Alone it is cycle-conserving EDF (slowest level that holds the utilization,
+ * a job counts with its WCET until it ends and with its measured cycles
+ * after); with MS_SLACK_STEALING the ES task chooses for each slack interval
+ * between sleeping at full speed and running slower.
+ */
+#ifndef MS_DVFS
+ #define MS_DVFS                                                             0
+#endif
+
+/*
+ * 1: idle windows longer than the Standby break even time end the ES task in
+ * Standby. The EDF state is checkpointed to the backup SRAM and the RTC wakeup
+ * timer resets the CPU before the next release; main() then rebuilds the task
+ * set with MsFreeRTOS_WarmBoot() instead of creating it.
+ */
+#ifndef MS_STANDBY
+ #define MS_STANDBY                                                          0
+#endif
+
+/*
+ * 1: procrastination (Jejurikar & Gupta): a job released while the CPU sleeps
+ * waits up to the procrastination interval of its task, computed from the
+ * admitted set, so that the idle intervals merge into longer sleeps.
+ */
+#ifndef MS_PROCRASTINATION
+ #define MS_PROCRASTINATION                                                  0
+#endif
+
+/* 1: energy accounting (MsEnergyStats), per task active cycles and energy   */
+#ifndef MS_ENERGY
+ #define MS_ENERGY                                                           0
+#endif
+
+/*
+ * 1: the clocks of the peripherals declared with MsFreeRTOS_TaskUsesPeripheral()
+ * are on from the release of a job of the task to its end. The drivers must
+ * be built with SYS_PERIPH_GATING 1 to give their own reference back.
+ */
+#ifndef MS_PERIPH_GATING
+ #define MS_PERIPH_GATING                                                    0
+#endif
+
+/*
+ * 1: cycles of the tick (or kernel timer event), of the context switch and of
+ * the release of a batch of jobs, in MsOverheadStats. The counter is the DWT
+ * on the target (portOVERHEAD_COUNTER).
+ */
+#ifndef MS_OVERHEAD_STATS
+ #define MS_OVERHEAD_STATS                                                   0
+#endif
+
+/*
+ * 1: response time, execution time and release jitter of every job of a
+ * task (min, max, mean and log2 histogram), updated at the job end and read
+ * with MsFreeRTOS_GetJobStats().
+ */
+#ifndef MS_JOB_STATS
+ #define MS_JOB_STATS                                                        0
+#endif
+
+/* Histogram of MS_JOB_STATS: bucket b counts the values of
+ * [2^(b+SHIFT), 2^(b+1+SHIFT)) cycles, the first and last ones are open     */
+#ifndef MS_JOB_STATS_BUCKETS
+ #define MS_JOB_STATS_BUCKETS                                                16
+#endif
+
+#ifndef MS_JOB_STATS_SHIFT
+ #define MS_JOB_STATS_SHIFT                                                  10
+#endif
+
+/*
+ * 1: SEGGER SystemView events of the EDF jobs and of the low power modes, in
+ * the module registered by MsFreeRTOS_SysViewInit() (after SEGGER_SYSVIEW_Conf)
+ */
+#ifndef MS_SYSVIEW
+ #define MS_SYSVIEW                                                          0
+#endif
+
+/*
+ * 1: binary trace of the jobs, of the kernel overheads and of the low power
+ * modes in a ring of MS_TRACE_SIZE records (a power of two), written without
+ * a lock by the ISRs and the tasks and drained by MsFreeRTOS_TraceRead().
+ * SIM/tracedec.c turns the stream into a Chrome/Perfetto trace.
+ */
+#ifndef MS_TRACE
+ #define MS_TRACE                                                            0
+#endif
+
+#ifndef MS_TRACE_SIZE
+ #define MS_TRACE_SIZE                                                       1024
+#endif
+
+#if ( MS_TRACE_SIZE & ( MS_TRACE_SIZE - 1 ) ) != 0
+ #error MS_TRACE_SIZE must be a power of two
+#endif
+
+/*
+ * 1: run to completion jobs (MsFreeRTOS_CreateJob). A job is a function
+ * called at each release; all of them run on one stack of MS_JOB_STACK_SIZE
+ * words where a preemption nests as an interrupt does, so such a task only
+ * costs its TCB. EDF never resumes a preempted job before the one that
+ * preempted it is over, unless its deadline is postponed.
+ */
+#ifndef MS_JOB_CALLBACK
+ #define MS_JOB_CALLBACK                                                     0
+#endif
+
+#ifndef MS_JOB_STACK_SIZE
+ #define MS_JOB_STACK_SIZE                                                   512
+#endif
+
+#if ( MS_JOB_CALLBACK == 1 ) && ( ( MS_OVERRUN_POLICY == MS_OVERRUN_BACKGROUND ) || ( MS_OVERRUN_POLICY == MS_OVERRUN_SKIP ) )
+ #error MS_JOB_CALLBACK: a postponed job would resume above the jobs nested on it
+#endif
+
+#if ( MS_PERIPH_GATING == 1 )
+ #include "sys_cfg_stm32f407.h"
+#endif
+
+/* Slack stealing of the ES task (MS_SLACK_STEALING == 1)                   */
+typedef struct
+{
+  uint32_t Calls;        /* SlackComputation() invocations                   */
+  uint32_t Scans;        /* invocations that scanned the schedule again      */
+  int32_t  Slack;        /* last slack returned, ticks                       */
+  uint16_t Points;       /* deadlines checked by the last scan               */
+  uint32_t Cycles;       /* DWT cycles of the last invocation                */
+  uint32_t MaxCycles;    /* worst invocation                                 */
+  uint32_t AcumUs;       /* total time spent, us at SystemCoreClock          */
+  uint32_t AcumRest;     /* cycles of the total under a us                   */
+} MsSlackStats_t;
+
+extern MsSlackStats_t MsSlackStats;
+
+/* Clock scaling (MS_DVFS == 1) over the levels of Sys_Clock_Table          */
+#define MS_DVFS_LEVELS                                                       4
+
+typedef struct
+{
+  uint32_t Switches;     /* clock level changes                              */
+  uint32_t SwitchCycles; /* DWT cycles of the last change (PLL lock included) */
+  uint32_t MaxSwitchCycles;
+  uint32_t Ticks[MS_DVFS_LEVELS]; /* ticks run at each level, sleep excluded */
+} MsDvfsStats_t;
+
+extern MsDvfsStats_t MsDvfsStats;
+
+/* Sleep decisions of the ES task, Es_Func or inline (MS_ES_INLINE == 1)   */
+typedef struct
+{
+  uint32_t Decisions;       /* slack evaluations                              */
+  uint32_t Sleeps;          /* low power entries                              */
+  uint32_t Entries;         /* entries that follow a job end                  */
+  uint32_t Procrastinated;  /* sleeps extended by MS_PROCRASTINATION          */
+  uint32_t EntryCycles;     /* DWT cycles from the job end to the entry (last) */
+  uint32_t MaxEntryCycles;
+  uint32_t AcumUs;          /* total of EntryCycles, us at SystemCoreClock    */
+  uint32_t AcumRest;        /* cycles of the total under a us                 */
+} MsEsStats_t;
+
+extern MsEsStats_t MsEsStats;
+
+/* Kernel overheads (MS_OVERHEAD_STATS == 1), portOVERHEAD_COUNTER cycles    */
+typedef struct
+{
+  uint32_t Count;        /* measured calls                                   */
+  uint32_t Max;          /* worst call                                       */
+  uint64_t Cycles;       /* total                                            */
+} MsOverhead_t;
+
+typedef struct
+{
+  MsOverhead_t Tick;     /* xTaskIncrementTick or the kernel timer event,
+                            releases included                                */
+  MsOverhead_t Switch;   /* vTaskSwitchContext                               */
+  MsOverhead_t Release;  /* a batch of jobs from the release queue to the
+                            ready lists, one call per batch                  */
+} MsOverheadStats_t;
+
+extern MsOverheadStats_t MsOverheadStats;
+
+/* A time of the jobs of a task (MS_JOB_STATS == 1), in CPU cycles at
+ * configCPU_CLOCK_HZ. Mean = Sum / Count.                                  */
+typedef struct
+{
+  uint32_t Count;
+  uint32_t Min;
+  uint32_t Max;
+  uint64_t Sum;
+  uint32_t Hist[MS_JOB_STATS_BUCKETS];
+} MsJobStat_t;
+
+typedef struct
+{
+  MsJobStat_t Response;  /* release (tick of the period) to the end          */
+  MsJobStat_t Exec;      /* DWT cycles in the CPU                            */
+  MsJobStat_t Jitter;    /* release to the first instruction of the job      */
+  uint32_t    Late;      /* jobs ended after their deadline                  */
+} MsJobStats_t;
+
+/* Low power transitions measured at boot (MS_LP_CALIBRATION == 1)          */
+typedef struct
+{
+  uint8_t  Valid;
+  uint32_t RefHz;           /* RTC clock (LSI or LSE) against the HSE        */
+  uint32_t SleepExitCycles; /* SLEEP: wake up event to the first instruction */
+  uint32_t StopExitUs;      /* STOP: regulator, flash and HSI wake up         */
+  uint32_t ClockRestoreUs;  /* HSE start and PLL lock after STOP              */
+  uint32_t WakeUs;          /* StopExitUs + ClockRestoreUs                    */
+  uint32_t StopTickHz;      /* SysTick rate in STOP, 0: stopped               */
+  uint16_t BetSleep;        /* break even times read by the ES task, ticks   */
+  uint16_t BetStop;
+  uint16_t WakeTicks;       /* STOP wake up left to the jobs after a sleep:
+                               the PLL lock with MS_LP_FAST_WAKE, raised by
+                               the longer wake ups seen at run time         */
+  uint32_t StandbyExitUs;   /* Standby: wake up to the scheduler start, as
+                               measured on the last warm boot (MS_STANDBY)  */
+  uint16_t BetStandby;      /* against STOP, ticks                           */
+} MsLpCalib_t;
+
+extern MsLpCalib_t MsLpCalib;
+
+/* STOP wake ups measured at run time                                       */
+typedef struct
+{
+  uint32_t ExitUs;          /* wake up to the first instruction (last), sleeps
+                               ended by the RTC wakeup timer (MS_LP_RTC_WAKE) */
+  uint32_t MaxExitUs;
+  uint32_t ExitSamples;
+  uint32_t Wakes;           /* restores on the HSI (MS_LP_FAST_WAKE)          */
+  uint32_t WaitUs;          /* PLL lock still to wait for at the switch (last) */
+  uint32_t MaxWaitUs;
+} MsLpWake_t;
+
+extern MsLpWake_t MsLpWake;
+
+/* Power modes of the energy accounting (MS_ENERGY == 1)                    */
+#define MS_ENERGY_RUN                                                        0
+#define MS_ENERGY_SLEEP                                                      1
+#define MS_ENERGY_STOP                                                       2
+#define MS_ENERGY_MODES                                                      3
+
+/*
+ * Trace hooks of the EDF jobs and of the low power modes (tasks.c), empty
+ * unless a tracer defines them (MS_SYSVIEW, MS_TRACE). Mode is
+ * MS_ENERGY_SLEEP, MS_ENERGY_STOP or MS_TRACE_STANDBY; a clock restore is
+ * MS_TRACE_CLOCK_HSI (kernel restarted on the HSI, MS_LP_FAST_WAKE) or
+ * MS_TRACE_CLOCK_PLL (Us: PLL lock waited).
+ */
+#define MS_TRACE_STANDBY                                                     3
+#define MS_TRACE_CLOCK_HSI                                                   0
+#define MS_TRACE_CLOCK_PLL                                                   1
+
+#if ( MS_SYSVIEW == 1 )
+ #include "SEGGER_SYSVIEW.h"
+
+ /* Events of the module, in the order of its description                  */
+ #define MS_SYSVIEW_RELEASE                                                  0
+ #define MS_SYSVIEW_END                                                      1
+ #define MS_SYSVIEW_PREEMPT                                                  2
+ #define MS_SYSVIEW_MISS                                                     3
+ #define MS_SYSVIEW_LP_ENTER                                                 4
+ #define MS_SYSVIEW_LP_EXIT                                                  5
+ #define MS_SYSVIEW_CLOCK                                                    6
+ #define MS_SYSVIEW_EVENTS                                                   7
+
+ extern SEGGER_SYSVIEW_MODULE MsSysViewModule;
+
+ void MsFreeRTOS_SysViewInit( void );
+
+ /* Nothing before the module has its offset: the ids would be the system ones */
+ #define MS_SYSVIEW_U32x2( Event, a, b )                                                          \
+   do { if( MsSysViewModule.EventOffset )                                                       \
+          SEGGER_SYSVIEW_RecordU32x2( MsSysViewModule.EventOffset + ( Event ), (U32)( a ), (U32)( b ) ); } while( 0 )
+#else
+ #define MS_SYSVIEW_U32x2( Event, a, b )
+#endif
+
+/* Record of the trace ring (MS_TRACE == 1): 12 bytes, little endian        */
+typedef struct
+{
+  uint32_t Time;         /* DWT cycles                                       */
+  uint32_t Arg;
+  uint16_t Id;           /* MsID of the task                                 */
+  uint8_t  Event;
+  uint8_t  Lap;          /* ring lap of the write (low 8 bits)               */
+} MsTraceRecord_t;
+
+/* Events of the trace ring: Id and Arg                                     */
+#define MS_TRACE_HEADER                                                      0  /* tick rate, DWT Hz (scheduler start) */
+#define MS_TRACE_NAME                                                        1  /* task, 4 characters of its name at offset Time */
+#define MS_TRACE_RELEASE                                                     2  /* task, absolute deadline */
+#define MS_TRACE_END                                                         3  /* task, lateness in ticks (signed) */
+#define MS_TRACE_PREEMPT                                                     4  /* task, MsID of the preempting job */
+#define MS_TRACE_MISS                                                        5  /* task, absolute deadline */
+#define MS_TRACE_SWITCH                                                      6  /* task switched in, cycles */
+#define MS_TRACE_TICK                                                        7  /* xTickCount (16 bits), cycles */
+#define MS_TRACE_BATCH                                                       8  /* jobs released, cycles */
+#define MS_TRACE_LP_ENTER                                                    9  /* mode, slack */
+#define MS_TRACE_LP_EXIT                                                     10 /* mode, xTickCount */
+#define MS_TRACE_CLOCK                                                       11 /* MS_TRACE_CLOCK_*, us waited */
+#define MS_TRACE_LOST                                                        12 /* -, records overwritten before read */
+
+#if ( MS_TRACE == 1 )
+ /* The cycles of SWITCH, TICK and BATCH are portOVERHEAD_COUNTER ones       */
+ void Ms_TraceWrite( uint32_t Time, uint8_t Event, uint16_t Id, uint32_t Arg );
+
+ /* Records written since the last call, at most ulMax, in pxBuf; a lost
+  * range is reported by a MS_TRACE_LOST record. One reader only.          */
+ uint32_t MsFreeRTOS_TraceRead( MsTraceRecord_t *pxBuf, uint32_t ulMax );
+
+ #define MS_TRACE_WRITE( Event, Id, Arg )    Ms_TraceWrite( GET_EXEC_TIME_US(), ( Event ), ( uint16_t )( Id ), ( uint32_t )( Arg ) )
+#else
+ #define MS_TRACE_WRITE( Event, Id, Arg )
+#endif
+
+#if ( MS_SYSVIEW == 1 ) || ( MS_TRACE == 1 )
+
+ #define traceMS_JOB_RELEASE( pxTCB )                                                             \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_RELEASE, SEGGER_SYSVIEW_ShrinkId( (U32)( pxTCB ) ), ( pxTCB )->MsAbsDeadLine ); \
+        MS_TRACE_WRITE( MS_TRACE_RELEASE, ( pxTCB )->MsID, ( pxTCB )->MsAbsDeadLine ); } while( 0 )
+ #define traceMS_JOB_END( pxTCB, Late )                                                           \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_END, SEGGER_SYSVIEW_ShrinkId( (U32)( pxTCB ) ), ( Late ) );  \
+        MS_TRACE_WRITE( MS_TRACE_END, ( pxTCB )->MsID, ( Late ) ); } while( 0 )
+ #define traceMS_JOB_PREEMPT( pxTCB, pxBy )                                                       \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_PREEMPT, SEGGER_SYSVIEW_ShrinkId( (U32)( pxTCB ) ), SEGGER_SYSVIEW_ShrinkId( (U32)( pxBy ) ) ); \
+        MS_TRACE_WRITE( MS_TRACE_PREEMPT, ( pxTCB )->MsID, ( pxBy )->MsID ); } while( 0 )
+ #define traceMS_JOB_MISS( pxTCB )                                                                \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_MISS, SEGGER_SYSVIEW_ShrinkId( (U32)( pxTCB ) ), ( pxTCB )->MsAbsDeadLine ); \
+        MS_TRACE_WRITE( MS_TRACE_MISS, ( pxTCB )->MsID, ( pxTCB )->MsAbsDeadLine ); } while( 0 )
+ #define traceMS_LP_ENTER( Mode, Slack )                                                          \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_LP_ENTER, ( Mode ), ( Slack ) );                             \
+        MS_TRACE_WRITE( MS_TRACE_LP_ENTER, ( Mode ), ( Slack ) ); } while( 0 )
+ #define traceMS_LP_EXIT( Mode, Tick )                                                            \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_LP_EXIT, ( Mode ), ( Tick ) );                               \
+        MS_TRACE_WRITE( MS_TRACE_LP_EXIT, ( Mode ), ( Tick ) ); } while( 0 )
+ #define traceMS_CLOCK_RESTORE( Clock, Us )                                                       \
+   do { MS_SYSVIEW_U32x2( MS_SYSVIEW_CLOCK, ( Clock ), ( Us ) );                                  \
+        MS_TRACE_WRITE( MS_TRACE_CLOCK, ( Clock ), ( Us ) ); } while( 0 )
+#endif
+
+#ifndef traceMS_JOB_RELEASE
+ #define traceMS_JOB_RELEASE( pxTCB )
+#endif
+#ifndef traceMS_JOB_END
+ #define traceMS_JOB_END( pxTCB, Late )
+#endif
+#ifndef traceMS_JOB_PREEMPT
+ #define traceMS_JOB_PREEMPT( pxTCB, pxBy )
+#endif
+#ifndef traceMS_JOB_MISS
+ #define traceMS_JOB_MISS( pxTCB )
+#endif
+#ifndef traceMS_LP_ENTER
+ #define traceMS_LP_ENTER( Mode, Slack )
+#endif
+#ifndef traceMS_LP_EXIT
+ #define traceMS_LP_EXIT( Mode, Tick )
+#endif
+#ifndef traceMS_CLOCK_RESTORE
+ #define traceMS_CLOCK_RESTORE( Clock, Us )
+#endif
+
+/* Power model: supply and current of each mode                             */
+typedef struct
+{
+  uint16_t SupplyMv;
+  uint16_t RunUA[MS_DVFS_LEVELS]; /* per level of Sys_Clock_Table, 0: RunUA of the table */
+  uint16_t SleepUA;
+  uint16_t StopUA;
+} MsEnergyModel_t;
+
+extern MsEnergyModel_t MsEnergyModel;
+
+/*
+ * Residency and transitions since the scheduler start. Updated by the ES task
+ * at each low power entry and exit; a debugger or RTT host can read it live,
+ * MsFreeRTOS_EnergyRead() takes a coherent copy with the run time up to now.
+ */
+typedef struct
+{
+  uint64_t Us[MS_ENERGY_MODES];         /* time in each mode                  */
+  uint32_t Entries[MS_ENERGY_MODES];    /* entries (RUN: wake ups)            */
+  uint64_t RunCycles[MS_DVFS_LEVELS];   /* DWT cycles awake at each level     */
+  uint32_t WakeUs;          /* STOP wake up to the kernel restart (last)      */
+  uint32_t MaxWakeUs;
+  uint32_t WakeSamples;     /* sleeps ended by the RTC wakeup timer           */
+  uint32_t Hyperperiod;     /* ticks, 0 when the task set has none in 32 bits */
+  uint32_t Hyperperiods;    /* completed                                      */
+  uint32_t HyperUj;         /* energy of the last complete hyperperiod        */
+  uint64_t Uj;              /* total energy (MsFreeRTOS_EnergyRead)           */
+} MsEnergyStats_t;
+
+extern MsEnergyStats_t MsEnergyStats;
+
 
 BaseType_t MsFreeRTOS_CreateTask
 (
@@ -29,6 +463,122 @@ BaseType_t MsFreeRTOS_CreateTask
   uint32_t    MsWcet                  /*Worst case execution time of task */
 );
 
+/* Remove a periodic task at runtime (NULL: calling task), the MsIDs above move down */
+BaseType_t MsFreeRTOS_DeleteTask( TaskHandle_t xTaskToDelete );
+
+/*
+ * Woken up from Standby (MS_STANDBY == 1) with a valid checkpoint: the tasks
+ * are created again with their period, deadline, job counters and next
+ * release, and pdTRUE is returned; vTaskStartScheduler() then moves the time
+ * on by the sleep. pdFALSE on any other reset: create the tasks as usual. The
+ * task code restarts from its entry and pvParameters must point to data that
+ * is set before the call. Handles are not kept.
+ */
+BaseType_t MsFreeRTOS_WarmBoot( void );
+
+/* Run to completion job (MS_JOB_CALLBACK == 1)                            */
+typedef void (*MsJobFunction_t)( void *pvArg );
+
+#if ( MS_JOB_CALLBACK == 1 )
+/*
+ * Periodic task of run to completion jobs: pxJobCode( pvArg ) is called at
+ * each release and the job ends when it returns (no Ms_EndJob_Exec). The
+ * handle (NULL: not needed) is a TaskHandle_t for the other calls; the task
+ * is deleted with MsFreeRTOS_DeleteTask().
+ *
+ * A job must not block: no vTaskDelay(), vTaskDelayUntil(), vTaskSuspend(),
+ * queue, semaphore or notification wait with a timeout. Its frame on
+ * MsJobStack would stay below the ones of the jobs that start meanwhile and
+ * be overwritten. The calls that would block assert (configASSERT) when the
+ * task is a job. Non blocking calls (timeout 0, the FromISR ones) are fine.
+ */
+BaseType_t MsFreeRTOS_CreateJob
+(
+  MsJobFunction_t pxJobCode                   ,
+  void * const pvArg                          ,
+  uint32_t    MsPeriod                        ,
+  uint32_t    MsRelDeadLine                   ,  /*Relative deadline*/
+  uint32_t    MsWcet                          ,  /*Worst case execution time of task */
+  TaskHandle_t * const pxCreatedJob
+);
+#endif
+
+/* Overrun and deadline miss counters of a task (NULL: calling task), no
+ * overrun with MS_OVERRUN_OFF                                             */
+void MsFreeRTOS_GetJobCounters( TaskHandle_t xTask, uint32_t *pulOverrun, uint32_t *pulMissedDeadLine );
+
+#if ( MS_JOB_STATS == 1 )
+/* Times of the jobs ended by a task (NULL: calling task); Reset clears them */
+void MsFreeRTOS_GetJobStats( TaskHandle_t xTask, MsJobStats_t *pxStats );
+void MsFreeRTOS_ResetJobStats( TaskHandle_t xTask );
+#endif
+
+#if ( MS_PERIPH_GATING == 1 )
+/*
+ * The jobs of a task (NULL: calling task) use a peripheral: its clock is
+ * referenced from each release to the job end. pdFAIL for the ES task and the
+ * CBS servers. Declare before the task code first accesses the peripheral.
+ */
+BaseType_t MsFreeRTOS_TaskUsesPeripheral( TaskHandle_t xTask, Sys_Periph_t ePeriph );
+#endif
+
+#if ( MS_ENERGY == 1 )
+/* Replace the power model, the per task energy from now on follows it      */
+void MsFreeRTOS_EnergySetModel( const MsEnergyModel_t *pxModel );
+
+/* Coherent copy of MsEnergyStats, open run interval and Uj included        */
+void MsFreeRTOS_EnergyRead( MsEnergyStats_t *pxStats );
+
+/* Active DWT cycles and energy (uJ) of a task (NULL: calling task)         */
+void MsFreeRTOS_GetTaskEnergy( TaskHandle_t xTask, uint64_t *pullCycles, uint64_t *pullUj );
+
+/*
+ * Text report of the accounting, one line per mode and per task, for RTT
+ * (SEGGER_RTT_WriteString) or a UART. Returns the length written.
+ */
+size_t MsFreeRTOS_EnergyReport( char *pcBuffer, size_t xBufferLength );
+#endif
+
+/* Constant Bandwidth Server for aperiodic requests (MS_CBS == 1)          */
+typedef void (*MsServerHandler_t)( void *pvRequest );
+typedef struct MsServer *MsServerHandle_t;
+
+BaseType_t MsFreeRTOS_CreateServer
+(
+  MsServerHandler_t pxHandler                 ,  /*Called by the server for each request */
+  const char * const pcName                   ,
+  const configSTACK_DEPTH_TYPE usStackDepth   ,
+  uint32_t    MsBudget                        ,  /*Server budget Qs     */
+  uint32_t    MsPeriod                        ,  /*Server period Ts     */
+  MsServerHandle_t * const pxCreatedServer
+);
+
+/* Queue a request from an ISR, then portYIELD_FROM_ISR(*pxHigherPriorityTaskWoken) */
+BaseType_t MsFreeRTOS_ServerRequestFromISR( MsServerHandle_t xServer, void *pvRequest, BaseType_t *pxHigherPriorityTaskWoken );
+
+/* Budgets exhausted (recharged, deadline postponed) and requests lost      */
+void MsFreeRTOS_GetServerCounters( MsServerHandle_t xServer, uint32_t *pulReplenished, uint32_t *pulLost );
+
+/* Schedulability of the admitted set plus a task (P, D, C), nothing is added */
+BaseType_t MsFreeRTOS_AdmissionTest
+(
+  uint32_t    MsPeriod          ,
+  uint32_t    MsRelDeadLine     ,
+  uint32_t    MsWcet            ,
+  MsAdmission_t *pxMargin
+);
+
+#if ( MS_RELEASE_QUEUE_BENCH == 1 )
+/* Release queue cycle count: sorted list x heap with 8, 32 and 64 jobs      */
+void Ms_ReleaseQueueBench(void);
+#endif
+
+#if ( MS_RELEASE_BATCH_BENCH == 1 )
+/* Worst case Ms_ReleaseJobs() with 8, 16, 32 and 64 simultaneous releases,
+ * batch and one job at a time                                              */
+void Ms_ReleaseBatchBench(void);
+#endif
+
 
 
 
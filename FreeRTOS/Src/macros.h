@@ -1151,6 +1151,8 @@ WARNING:      The macro does not checks the type of the variables, therefore,
 *******************************************************************************/
 
 /* DWT (Data Watchpoint and Trace) registers, only exists on ARM Cortex with a DWT unit */
+/* The host build (POSIX port) maps them in its stm32f4xx.h */
+#ifndef KIN1_DWT_CYCCNT
 
   #define KIN1_DWT_CONTROL             (*((volatile uint32_t*)0xE0001000))
 
@@ -1172,6 +1174,8 @@ WARNING:      The macro does not checks the type of the variables, therefore,
 
     /*!< Trace enable bit in DEMCR register */
 
+#endif
+
  
 
 #define KIN1_InitCycleCounter() \
@@ -76,6 +76,13 @@ void MathFunction(uint32_t C)
   }
 }
 
+#if ( MS_JOB_CALLBACK == 1 )
+/* One job of MyTask_Func1: returns at its end */
+void MyJob_Func(void *pvArg )
+{
+  MathFunction(*(uint16_t *) pvArg);
+}
+#endif
 
 void MyTask_Func1(void *pvParameters )
 {
@@ -1129,12 +1136,34 @@ int main(void)
   #define stack_task 100
 
   setup();
+
+#if ( MS_SYSVIEW == 1 )
+  /* Before the tasks, so that SystemView gets their creation */
+  SEGGER_SYSVIEW_Conf();
+  MsFreeRTOS_SysViewInit();
+#endif
   
   DeadlineEsTask = 126;
-  PeriodTask0=181;CostTask0=126;MsFreeRTOS_CreateEnergySavingTask(  "Es Task", stack_task, (void*) &CostTask0 ,  NULL  , PeriodTask0,DeadlineEsTask, CostTask0 );
-
-  PeriodTask1=5.0;CostTask1=1.0;MsFreeRTOS_CreateTask(  MyTask_Func1, "Task1", stack_task, (void*) &CostTask1 , 10 , NULL  , PeriodTask1,PeriodTask1, CostTask1 );
-  PeriodTask2=10.0;CostTask2=3.0;MsFreeRTOS_CreateTask(  MyTask_Func2, "Task2", stack_task, (void*) &CostTask2 , 10 , NULL  , PeriodTask2,PeriodTask2, CostTask2 );
+  PeriodTask0=181;CostTask0=126;
+  PeriodTask1=5.0;CostTask1=1.0;
+  PeriodTask2=10.0;CostTask2=3.0;
+
+#if ( MS_STANDBY == 1 )
+  /* Woken up from Standby: the task set comes from the backup SRAM */
+  if( MsFreeRTOS_WarmBoot() == pdFALSE )
+#endif
+  {
+    MsFreeRTOS_CreateEnergySavingTask(  "Es Task", stack_task, (void*) &CostTask0 ,  NULL  , PeriodTask0,DeadlineEsTask, CostTask0 );
+
+#if ( MS_JOB_CALLBACK == 1 )
+    /* Only a TCB each, the jobs run on the shared stack */
+    MsFreeRTOS_CreateJob(  MyJob_Func, (void*) &CostTask1 , PeriodTask1,PeriodTask1, CostTask1, NULL );
+    MsFreeRTOS_CreateJob(  MyJob_Func, (void*) &CostTask2 , PeriodTask2,PeriodTask2, CostTask2, NULL );
+#else
+    MsFreeRTOS_CreateTask(  MyTask_Func1, "Task1", stack_task, (void*) &CostTask1 , 10 , NULL  , PeriodTask1,PeriodTask1, CostTask1 );
+    MsFreeRTOS_CreateTask(  MyTask_Func2, "Task2", stack_task, (void*) &CostTask2 , 10 , NULL  , PeriodTask2,PeriodTask2, CostTask2 );
+#endif
+  }
 
   GPIO_SetOutput(0);
   vTaskStartScheduler();
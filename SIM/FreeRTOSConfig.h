@@ -0,0 +1,192 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+#include "stm32f4xx.h"
+/*-----------------------------------------------------------
+ * Host simulation (POSIX port) of the FreeRTOS/Src configuration: same
+ * kernel options, no SEGGER SystemView. Every MS_* option can be set from
+ * the make command line (make DEFS="-DMS_DVFS=1").
+ *----------------------------------------------------------*/
+
+#define configUSE_PREEMPTION			1
+#define configUSE_IDLE_HOOK				1	/* the idle task runs virtual cycles */
+#define configUSE_TICK_HOOK				0
+#define configCPU_CLOCK_HZ				 168000000
+#define configTICK_RATE_HZ				( ( TickType_t ) 1000 )
+#define configMAX_PRIORITIES			( 11 )
+#define configMINIMAL_STACK_SIZE		( ( unsigned short ) 330 )
+#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 60 * 1024 ) )
+#define configMAX_TASK_NAME_LEN			( 20 )
+#define configUSE_TRACE_FACILITY		0
+#define configUSE_16_BIT_TICKS			0
+#define configIDLE_SHOULD_YIELD			1
+#define configUSE_MUTEXES				1
+#define configQUEUE_REGISTRY_SIZE		8
+#define configCHECK_FOR_STACK_OVERFLOW	0
+#define configUSE_RECURSIVE_MUTEXES		1
+#define configUSE_MALLOC_FAILED_HOOK	0
+#define configUSE_APPLICATION_TASK_TAG	0
+#define configUSE_COUNTING_SEMAPHORES	0
+#define configGENERATE_RUN_TIME_STATS	0
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES 		0
+#define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
+
+/* Software timer definitions. */
+#define configUSE_TIMERS				0
+#define configTIMER_TASK_PRIORITY		( 2 )
+#define configTIMER_QUEUE_LENGTH		10
+#define configTIMER_TASK_STACK_DEPTH	( configMINIMAL_STACK_SIZE * 2 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet		1
+#define INCLUDE_uxTaskPriorityGet		1
+#define INCLUDE_vTaskDelete				1
+#define INCLUDE_vTaskCleanUpResources	1
+#define INCLUDE_vTaskSuspend			1
+#define INCLUDE_vTaskDelayUntil			1
+#define INCLUDE_vTaskDelay				1
+
+/* Cortex-M specific definitions, kept for the BASEPRI values. */
+#define configPRIO_BITS       		__NVIC_PRIO_BITS
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY			0xf
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY	5
+#define configKERNEL_INTERRUPT_PRIORITY 		( configLIBRARY_LOWEST_INTERRUPT_PRIORITY << (8 - configPRIO_BITS) )
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY 	( configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - configPRIO_BITS) )
+
+/* An assertion stops the simulation where it failed. */
+#include <stdlib.h>
+#define configASSERT( x ) if( ( x ) == 0 ) { abort(); }
+
+#define INCLUDE_xTaskGetIdleTaskHandle 1
+#define INCLUDE_pxTaskGetStackStart    1
+
+
+//#define EDF_SCHD                                                  EDF_SCHD_RAND
+#ifndef MS_SCHD
+#define MS_SCHD                                                    MS_SCHD_FAIR
+#endif
+
+#ifndef MS_TICKLESS
+#define MS_TICKLESS                                                0
+#endif
+
+#ifndef MS_ADMISSION_CONTROL
+#define MS_ADMISSION_CONTROL                                       MS_ADMISSION_MARGIN
+#endif
+
+#ifndef MS_CBS
+#define MS_CBS                                                     0
+#endif
+
+#ifndef MS_OVERRUN_POLICY
+#define MS_OVERRUN_POLICY                                          MS_OVERRUN_OFF
+#endif
+
+#ifndef MS_SLACK_STEALING
+#define MS_SLACK_STEALING                                          1
+#endif
+
+#ifndef MS_DVFS
+#define MS_DVFS                                                    0
+#endif
+
+#ifndef MS_LP_CALIBRATION
+#define MS_LP_CALIBRATION                                          1
+#endif
+
+#ifndef MS_LP_RTC_WAKE
+#define MS_LP_RTC_WAKE                                             1
+#endif
+
+#ifndef MS_LP_FAST_WAKE
+#define MS_LP_FAST_WAKE                                            1
+#endif
+
+/* Standby is a reset: the simulation has no warm boot */
+#ifndef MS_STANDBY
+#define MS_STANDBY                                                 0
+#endif
+#if ( MS_STANDBY == 1 )
+#error "MS_STANDBY is not simulated"
+#endif
+
+#ifndef MS_ES_INLINE
+#define MS_ES_INLINE                                               0
+#endif
+
+#ifndef MS_PROCRASTINATION
+#define MS_PROCRASTINATION                                         0
+#endif
+
+#ifndef MS_ENERGY
+#define MS_ENERGY                                                  1
+#endif
+
+#ifndef MS_PERIPH_GATING
+#define MS_PERIPH_GATING                                           0
+#endif
+
+/* No SEGGER SystemView on the host */
+#ifndef MS_SYSVIEW
+#define MS_SYSVIEW                                                 0
+#endif
+#if ( MS_SYSVIEW == 1 )
+#error "MS_SYSVIEW needs the target"
+#endif
+
+/* Host cycles here: the kernel code takes no virtual time */
+#ifndef MS_OVERHEAD_STATS
+#define MS_OVERHEAD_STATS                                          1
+#endif
+
+/* Response times of the tasks in the sim output */
+#ifndef MS_JOB_STATS
+#define MS_JOB_STATS                                               1
+#endif
+
+/* sim -x file: build with DEFS="-DMS_TRACE=1" */
+#ifndef MS_TRACE
+#define MS_TRACE                                                   0
+#endif
+
+/* The ring is only drained by the idle task */
+#ifndef MS_TRACE_SIZE
+#define MS_TRACE_SIZE                                              65536
+#endif
+
+/* sim -j: the task set as run to completion jobs */
+#ifndef MS_JOB_CALLBACK
+#define MS_JOB_CALLBACK                                            1
+#endif
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,488 @@
+/*
+ * Randomized task set benchmark of the ES-EDF kernel on the host simulation.
+ * For each point of a utilization x task count grid it generates random
+ * implicit deadline task sets (UUniFast or Randfixedsum), runs each one for
+ * a number of hyperperiods and prints one CSV line per set: kernel overheads
+ * (MS_OVERHEAD_STATS), release and ready list operations, deadline misses,
+ * sleeps and the time and energy of each power mode.
+ *
+ *   bench [-g uunifast|randfixedsum] [-u min:max:step] [-n min:max:step]
+ *         [-k sets] [-r seed] [-N hyperperiods] [-H ticks] [-p min:max]
+ *         [-e percent] [-s P:C:D] [-T seconds]
+ *
+ *   -g  utilization generator (default uunifast)
+ *   -u  total utilization range (default 0.1:0.9:0.1)
+ *   -n  task count range (default 2:10:4)
+ *   -k  task sets per point (default 10)
+ *   -r  seed; set i is generated from seed and i only (default 1)
+ *   -N  hyperperiods run by each set (default 2)
+ *   -H  base hyperperiod in ticks: the periods are its divisors, so the
+ *       hyperperiod of a set is at most H (default 3600)
+ *   -p  period range in ticks, log-uniform (default 10:1000)
+ *   -e  part of its utilization each job executes (default 100)
+ *   -s  ES task period, WCET and deadline (default H:1:H)
+ *   -T  host time limit of a set (default 60 s)
+ *
+ * The kernel globals are not reset by the scheduler end, so every set runs in
+ * its own process. The overheads are host cycles (the kernel code takes no
+ * virtual time): compare them between kernel options and task sets, not with
+ * the DWT figures of the board.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MS_FREERTOS.h"
+#include "sys_cfg_stm32f407.h"
+#include "port_sim.h"
+
+#if ( MS_OVERHEAD_STATS != 1 )
+ #error "the benchmark reads MsOverheadStats: build with MS_OVERHEAD_STATS 1"
+#endif
+
+#define BENCH_TASK_MAX                 32
+#define BENCH_STACK                    100
+#define BENCH_DIV_MAX                  256
+#define BENCH_LINE                     1024
+
+#define BENCH_UUNIFAST                 0
+#define BENCH_RANDFIXEDSUM             1
+
+typedef struct
+{
+  uint32_t Period;
+  uint32_t Wcet;       /* ticks, ceil of U.P                                  */
+  uint32_t Cycles;     /* executed by each job                               */
+  double   U;
+  TaskHandle_t Handle;
+} BenchTask_t;
+
+BaseType_t MsFreeRTOS_CreateEnergySavingTask( const char * const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+    void * const pvParameters, TaskHandle_t * const pxCreatedTask, uint32_t MsPeriod, uint32_t MsRelDeadLine, uint32_t MsWcet );
+void Ms_EndJob_Exec( void );
+void setup( void );
+
+extern uint32_t missedDeadline;
+extern uint32_t CountLp;
+extern uint32_t ReleaseJobCounter;
+extern uint32_t rel_prmpCounter;
+extern uint32_t rel_no_prmpCounter;
+extern uint32_t PopMinCounter;
+
+static BenchTask_t BenchTasks[BENCH_TASK_MAX];
+static uint32_t    BenchTaskQnt;
+
+static uint32_t    BenchDiv[BENCH_DIV_MAX];
+static uint32_t    BenchDivQnt;
+
+static uint64_t    BenchRng;
+
+static const char *BenchGenName[] = { "uunifast", "randfixedsum" };
+
+void vApplicationIdleHook( void )
+{
+  vPortSimExecute( 100 );
+}
+
+static void BenchTask_Func( void *pvParameters )
+{
+  BenchTask_t *T = ( BenchTask_t * ) pvParameters;
+
+  while(1)
+  {
+    vPortSimExecute( T->Cycles );
+
+    Ms_EndJob_Exec();
+  }
+}
+
+/* splitmix64: seed of a set from the run seed and the set number           */
+static uint64_t BenchMix( uint64_t x )
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x  = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+  x  = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+  return x ^ ( x >> 31 );
+}
+
+/* xorshift64*, uniform in (0, 1]                                           */
+static double BenchRand( void )
+{
+  BenchRng ^= BenchRng >> 12;
+  BenchRng ^= BenchRng << 25;
+  BenchRng ^= BenchRng >> 27;
+  return ( double ) ( ( ( BenchRng * 0x2545F4914F6CDD1DULL ) >> 11 ) + 1 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+/* UUniFast (Bini & Buttazzo): n utilizations that sum to U                 */
+static void BenchUUniFast( double *u, uint32_t n, double U )
+{
+  double Sum = U, Next;
+  uint32_t i;
+
+  for( i = 0; i + 1 < n; i++ )
+  {
+    Next  = Sum * pow( BenchRand(), 1.0 / ( double ) ( n - i - 1 ) );
+    u[i]  = Sum - Next;
+    Sum   = Next;
+  }
+  u[n - 1] = Sum;
+}
+
+/*
+ * Randfixedsum (Stafford, as used by Emberson et al.): n utilizations in
+ * [0, 1] that sum to U, uniform over that simplex slice. The table rows are
+ * weighted means of the previous ones, so starting from DBL_MAX keeps the
+ * precision without an overflow.
+ */
+static void BenchRandFixedSum( double *u, uint32_t n, double U )
+{
+  static double w[BENCH_TASK_MAX][BENCH_TASK_MAX + 1];
+  static double t[BENCH_TASK_MAX][BENCH_TASK_MAX];
+  double s1[BENCH_TASK_MAX], s2[BENCH_TASK_MAX];
+  double s = U, sm = 0, pr = 1, sx, Tmp1, Tmp2, Tmp3, Swap;
+  uint32_t k, i, c, j, e;
+
+  if( n == 1 )
+  {
+    u[0] = U;
+    return;
+  }
+
+  k = ( uint32_t ) floor( U );
+  if( k > n - 1 )
+    k = n - 1;
+
+  for( i = 0; i < n; i++ )
+  {
+    s1[i] = s - ( double ) k + ( double ) i;
+    s2[i] = ( double ) ( k + n - i ) - s;
+  }
+
+  memset( w, 0, sizeof( w ) );
+  w[0][1] = DBL_MAX;
+
+  for( i = 2; i <= n; i++ )
+  {
+    for( c = 0; c < i; c++ )
+    {
+      Tmp1 = w[i - 2][c + 1] * s1[c] / ( double ) i;
+      Tmp2 = w[i - 2][c] * s2[n - i + c] / ( double ) i;
+      w[i - 1][c + 1] = Tmp1 + Tmp2;
+      Tmp3 = w[i - 1][c + 1] + DBL_MIN;
+      t[i - 2][c] = ( s2[n - i + c] > s1[c] ) ? Tmp2 / Tmp3 : 1.0 - Tmp1 / Tmp3;
+    }
+  }
+
+  j = k + 1;
+  for( i = n - 1; i >= 1; i-- )
+  {
+    e   = ( BenchRand() <= t[i - 1][j - 1] ) ? 1 : 0;
+    sx  = pow( BenchRand(), 1.0 / ( double ) i );
+    sm += ( 1.0 - sx ) * pr * s / ( double ) ( i + 1 );
+    pr *= sx;
+    u[n - i - 1] = sm + pr * e;
+    s -= e;
+    j -= e;
+  }
+  u[n - 1] = sm + pr * s;
+
+  /* The coordinates come in a fixed order: shuffle them                   */
+  for( i = n - 1; i >= 1; i-- )
+  {
+    c    = ( uint32_t ) ( BenchRand() * ( i + 1 ) );
+    if( c > i )
+      c = i;
+    Swap = u[i];
+    u[i] = u[c];
+    u[c] = Swap;
+  }
+}
+
+/* Divisor of H nearest to a log-uniform period in [Pmin, Pmax]             */
+static uint32_t BenchPeriod( uint32_t Pmin, uint32_t Pmax )
+{
+  double x = log( ( double ) Pmin ) + BenchRand() * ( log( ( double ) Pmax ) - log( ( double ) Pmin ) );
+  double Best = DBL_MAX, d;
+  uint32_t i, P = BenchDiv[0];
+
+  for( i = 0; i < BenchDivQnt; i++ )
+  {
+    d = fabs( log( ( double ) BenchDiv[i] ) - x );
+    if( d < Best )
+    {
+      Best = d;
+      P    = BenchDiv[i];
+    }
+  }
+  return P;
+}
+
+static uint64_t BenchGcd( uint64_t a, uint64_t b )
+{
+  while( b )
+  {
+    uint64_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+/*
+ * Runs the generated set in this (child) process and writes the measured
+ * columns to Fd.
+ */
+static void BenchRun( int Fd, const uint32_t Es[3], uint64_t Ticks )
+{
+  const PortSimStats_t *S;
+  const MsOverhead_t *O[3] = { &MsOverheadStats.Tick, &MsOverheadStats.Switch, &MsOverheadStats.Release };
+  uint32_t i, Missed = 0, Late = 0;
+  double Uj = 0;
+  char Line[BENCH_LINE];
+  int Len;
+
+  Sys_Configure_Clock_168MHz();
+
+  setup();
+
+  MsFreeRTOS_CreateEnergySavingTask( "Es Task", BENCH_STACK, NULL, NULL, Es[0], Es[2], Es[1] );
+
+  for( i = 0; i < BenchTaskQnt; i++ )
+  {
+    char Name[configMAX_TASK_NAME_LEN];
+
+    snprintf( Name, sizeof( Name ), "Task%u", ( unsigned ) ( i + 1 ) );
+    MsFreeRTOS_CreateTask( BenchTask_Func, Name, BENCH_STACK, &BenchTasks[i], 10, &BenchTasks[i].Handle,
+        BenchTasks[i].Period, BenchTasks[i].Period, BenchTasks[i].Wcet );
+  }
+
+  vPortSimSetEndTime( Ticks * 1000000ULL / configTICK_RATE_HZ );
+  vTaskStartScheduler();
+
+  S = pxPortSimStats();
+
+  for( i = 0; i < BenchTaskQnt; i++ )
+  {
+    uint32_t Overrun, TaskMissed;
+
+    if( BenchTasks[i].Handle == NULL )
+      continue;
+    MsFreeRTOS_GetJobCounters( BenchTasks[i].Handle, &Overrun, &TaskMissed );
+    Missed += TaskMissed;
+    if( TaskMissed )
+      Late++;
+  }
+
+  for( i = 0; i < portSIM_MODES; i++ )
+    Uj += S->Uj[i];
+  Uj += S->WakeUj;
+
+  Len = snprintf( Line, sizeof( Line ), "%u,%u,%u,%u,%u", ( unsigned ) xTaskGetTickCount(), ( unsigned ) ReleaseJobCounter,
+      ( unsigned ) Missed, ( unsigned ) Late, ( unsigned ) missedDeadline );
+
+  for( i = 0; i < 3; i++ )
+    Len += snprintf( Line + Len, sizeof( Line ) - Len, ",%u,%.1f,%u", ( unsigned ) O[i]->Count,
+        O[i]->Count ? ( double ) O[i]->Cycles / O[i]->Count : 0.0, ( unsigned ) O[i]->Max );
+
+  Len += snprintf( Line + Len, sizeof( Line ) - Len, ",%.1f,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.1f,%s\n",
+      ReleaseJobCounter ? ( double ) MsOverheadStats.Release.Cycles / ReleaseJobCounter : 0.0,
+      ( unsigned ) rel_prmpCounter, ( unsigned ) rel_no_prmpCounter, ( unsigned ) PopMinCounter,
+      ( unsigned ) CountLp, ( unsigned ) MsEsStats.Sleeps,
+      ( double ) S->Ps[portSIM_RUN] / 1e9, ( double ) S->Ps[portSIM_SLEEP] / 1e9, ( double ) S->Ps[portSIM_STOP] / 1e9,
+      ( double ) S->WakePs / 1e9, Uj, S->Stalled ? "stalled" : "ok" );
+
+  if( write( Fd, Line, Len ) != Len )
+    _exit( EXIT_FAILURE );
+}
+
+static int BenchRange( const char *Arg, double Out[3], int Need )
+{
+  int n = sscanf( Arg, "%lf:%lf:%lf", &Out[0], &Out[1], &Out[2] );
+
+  if( n == 1 )
+    Out[1] = Out[0];
+  if( n < 1 || n < Need || Out[1] < Out[0] )
+    return 0;
+  return 1;
+}
+
+static void BenchUsage( void )
+{
+  fprintf( stderr, "usage: bench [-g uunifast|randfixedsum] [-u min:max:step] [-n min:max:step] [-k sets] [-r seed]\n"
+                   "             [-N hyperperiods] [-H ticks] [-p min:max] [-e percent] [-s P:C:D] [-T seconds]\n" );
+  exit( EXIT_FAILURE );
+}
+
+int main( int argc, char **argv )
+{
+  double   Urange[3] = { 0.1, 0.9, 0.1 }, Nrange[3] = { 2, 10, 4 }, Prange[3] = { 10, 1000, 0 };
+  double   u[BENCH_TASK_MAX], Target, Uwcet;
+  uint32_t Gen = BENCH_UUNIFAST, Sets = 10, Hyperperiods = 2, H = 3600, Percent = 100, Limit = 60;
+  uint32_t Es[3] = { 0, 1, 0 };
+  uint64_t Seed = 1, Hyper;
+  uint32_t i, n, k, Set = 0, Ui;
+  int      Fd[2], Status;
+  char     Line[BENCH_LINE];
+  ssize_t  Len;
+  pid_t    Pid;
+
+  for( i = 1; i < ( uint32_t ) argc; i++ )
+  {
+    const char *Opt = argv[i];
+
+    if( Opt[0] != '-' || Opt[1] == 0 || Opt[2] != 0 || i + 1 >= ( uint32_t ) argc )
+      BenchUsage();
+    Opt = argv[++i];
+
+    switch( argv[i - 1][1] )
+    {
+      case 'g':
+        if( strcmp( Opt, "uunifast" ) == 0 )
+          Gen = BENCH_UUNIFAST;
+        else if( strcmp( Opt, "randfixedsum" ) == 0 )
+          Gen = BENCH_RANDFIXEDSUM;
+        else
+          BenchUsage();
+        break;
+      case 'u': if( !BenchRange( Opt, Urange, 1 ) ) BenchUsage(); break;
+      case 'n': if( !BenchRange( Opt, Nrange, 1 ) ) BenchUsage(); break;
+      case 'p': if( !BenchRange( Opt, Prange, 2 ) ) BenchUsage(); break;
+      case 'k': Sets = strtoul( Opt, NULL, 0 ); break;
+      case 'r': Seed = strtoull( Opt, NULL, 0 ); break;
+      case 'N': Hyperperiods = strtoul( Opt, NULL, 0 ); break;
+      case 'H': H = strtoul( Opt, NULL, 0 ); break;
+      case 'e': Percent = strtoul( Opt, NULL, 0 ); break;
+      case 'T': Limit = strtoul( Opt, NULL, 0 ); break;
+      case 's':
+        if( sscanf( Opt, "%u:%u:%u", &Es[0], &Es[1], &Es[2] ) != 3 || Es[0] == 0 || Es[1] == 0 )
+          BenchUsage();
+        break;
+      default:
+        BenchUsage();
+    }
+  }
+
+  if( Es[0] == 0 )
+  {
+    Es[0] = H;
+    Es[2] = H;
+  }
+  if( Urange[2] <= 0 )
+    Urange[2] = 1;
+  if( Nrange[2] < 1 )
+    Nrange[2] = 1;
+
+  if( H == 0 || Sets == 0 || Hyperperiods == 0 || Urange[0] <= 0 || Urange[1] > 1 ||
+      Nrange[0] < 1 || Nrange[1] > BENCH_TASK_MAX || Prange[0] < 1 )
+    BenchUsage();
+
+  for( i = 1; i <= H && BenchDivQnt < BENCH_DIV_MAX; i++ )
+    if( H % i == 0 && i >= Prange[0] && i <= Prange[1] )
+      BenchDiv[BenchDivQnt++] = i;
+
+  if( BenchDivQnt == 0 )
+  {
+    fprintf( stderr, "bench: no divisor of %u in the period range\n", ( unsigned ) H );
+    return EXIT_FAILURE;
+  }
+
+  printf( "set,seed,gen,n,u_target,u_wcet,hyperperiod,run_ticks,"
+          "kernel_ticks,jobs,missed_jobs,tasks_missed,late_ticks,"
+          "tick_n,tick_mean,tick_max,switch_n,switch_mean,switch_max,release_n,release_mean,release_max,release_per_job,"
+          "rel_prmp,rel_no_prmp,popmin,lp_entries,sleeps,"
+          "run_ms,sleep_ms,stop_ms,wake_ms,energy_uj,status\n" );
+
+  for( n = ( uint32_t ) Nrange[0]; n <= ( uint32_t ) Nrange[1]; n += ( uint32_t ) Nrange[2] )
+  {
+    /* Integer steps, so that the grid does not lose its last point         */
+    for( Ui = 0; Urange[0] + Ui * Urange[2] <= Urange[1] + 1e-9; Ui++ )
+    {
+      Target = Urange[0] + Ui * Urange[2];
+
+      for( k = 0; k < Sets; k++, Set++ )
+      {
+        uint64_t SetSeed = BenchMix( Seed ^ BenchMix( Set ) );
+
+        BenchRng = SetSeed ? SetSeed : 1;
+
+        if( Gen == BENCH_UUNIFAST )
+          BenchUUniFast( u, n, Target );
+        else
+          BenchRandFixedSum( u, n, Target );
+
+        Hyper = Es[0];
+        Uwcet = 0;
+        for( i = 0; i < n; i++ )
+        {
+          BenchTasks[i].U      = u[i];
+          BenchTasks[i].Period = BenchPeriod( ( uint32_t ) Prange[0], ( uint32_t ) Prange[1] );
+          BenchTasks[i].Wcet   = ( uint32_t ) ceil( u[i] * BenchTasks[i].Period - 1e-9 );
+          if( BenchTasks[i].Wcet == 0 )
+            BenchTasks[i].Wcet = 1;
+          BenchTasks[i].Cycles = ( uint32_t ) ( u[i] * BenchTasks[i].Period * ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) * Percent / 100 );
+          BenchTasks[i].Handle = NULL;
+          Uwcet += ( double ) BenchTasks[i].Wcet / BenchTasks[i].Period;
+          Hyper  = Hyper / BenchGcd( Hyper, BenchTasks[i].Period ) * BenchTasks[i].Period;
+        }
+        BenchTaskQnt = n;
+
+        printf( "%u,%llu,%s,%u,%.3f,%.4f,%llu,%llu,", ( unsigned ) Set, ( unsigned long long ) SetSeed, BenchGenName[Gen],
+            ( unsigned ) n, Target, Uwcet, ( unsigned long long ) Hyper, ( unsigned long long ) ( Hyper * Hyperperiods ) );
+        fflush( stdout );
+
+        if( pipe( Fd ) != 0 )
+        {
+          perror( "bench: pipe" );
+          return EXIT_FAILURE;
+        }
+
+        Pid = fork();
+        if( Pid < 0 )
+        {
+          perror( "bench: fork" );
+          return EXIT_FAILURE;
+        }
+        if( Pid == 0 )
+        {
+          close( Fd[0] );
+          alarm( Limit );
+          BenchRun( Fd[1], Es, Hyper * Hyperperiods );
+          _exit( EXIT_SUCCESS );
+        }
+
+        close( Fd[1] );
+        Len = 0;
+        for( ;; )
+        {
+          ssize_t r = read( Fd[0], Line + Len, sizeof( Line ) - 1 - Len );
+
+          if( r <= 0 )
+            break;
+          Len += r;
+        }
+        close( Fd[0] );
+        Line[Len] = 0;
+
+        waitpid( Pid, &Status, 0 );
+
+        if( WIFEXITED( Status ) && WEXITSTATUS( Status ) == EXIT_SUCCESS && Len > 0 )
+          fputs( Line, stdout );
+        else
+          /* The columns of a set that did not end: status only           */
+          printf( ",,,,,,,,,,,,,,,,,,,,,,,,,%s\n", ( WIFSIGNALED( Status ) && WTERMSIG( Status ) == SIGALRM ) ? "timeout" : "crash" );
+        fflush( stdout );
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,788 @@
+/*
+ * Host simulation of the ES-EDF kernel: runs a periodic task set on the POSIX
+ * port (virtual time, power model of port_sim.h) and prints the deadline
+ * misses, the sleeps and the energy seen by both the simulator and the
+ * kernel accounting (MS_ENERGY).
+ *
+ *   sim [-t ms] [-e percent] [-s P:C:D] [-f TASK_SET.h] [-m model] [-x file]
+ *       [-j] [-b] [-r] [-c] [-l N:ms] [-a Q:T:W] [-o percent] [P:C[:D] ...]
+ *
+ *   -t  virtual run time (default 10000 ms)
+ *   -e  part of its WCET each job executes (default 100)
+ *   -s  ES task period, WCET and deadline (default 181:126:126, as main.c)
+ *   -f  task set of a TASK_SET.h: the #define Tn_P and Tn_C (and Tn_D) that
+ *       are not commented out
+ *   -m  power model: lines "Field value" of PortSimPower_t (port_sim.h), #
+ *       comments; the RUN currents of the PLL are the ones of Sys_Clock_Table
+ *   -x  binary trace (MS_TRACE) into file, for tracedec
+ *   -j  the tasks as run to completion jobs on the shared stack
+ *       (MsFreeRTOS_CreateJob, MS_JOB_CALLBACK)
+ *   -b  prints the release queue and release batch benchmarks
+ *       (MS_RELEASE_QUEUE_BENCH, MS_RELEASE_BATCH_BENCH), in host cycles,
+ *       instead of a run
+ *   -r  every task must be refused by the admission test
+ *       (MS_ADMISSION_REJECT): the run is the ES task alone
+ *   -c  task set changes at run time (SimChurn), at least two tasks
+ *   -l  fewer than N low power entries and more than ms in low power (SLEEP
+ *       and STOP) than a reference run: "sleep check" of the reference
+ *       (make check-procrast)
+ *   -a  CBS server of budget Q and period T ticks (MS_CBS): each job of the
+ *       first task queues a request of W ticks of work (SimCbs)
+ *   -o  the first task executes percent (over 100) of its WCET in each job
+ *       (MS_OVERRUN_POLICY): every job of it must count an overrun, the
+ *       other tasks keep their deadlines and so does the first one but
+ *       with MS_OVERRUN_BACKGROUND
+ *   P:C[:D]  periodic task in ticks, D = P by default (default 5:1 10:3)
+ *
+ * With MS_LP_CALIBRATION the break even times of the kernel are measured on
+ * the model at boot, so the ES decisions follow a -m model too; -t counts
+ * from the scheduler start, after it. The exit status is 1 when the run
+ * stalled, the kernel time drifted from the virtual time (tick check), a
+ * job missed its deadline, with -r a task was admitted, with -c a check of
+ * the changes failed, with -l the sleep check failed or with -a a request
+ * was lost, left unserved or did not exhaust the budget as it should or with
+ * -o a job of the first task did not count an overrun.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MS_FREERTOS.h"
+#include "sys_cfg_stm32f407.h"
+#include "port_sim.h"
+
+#define SIM_TASK_MAX                   32
+#define SIM_STACK                      100
+#define SIM_DRIFT_MAX                  2.0
+
+typedef struct
+{
+  uint32_t Period;
+  uint32_t Deadline;
+  uint32_t Wcet;
+  uint32_t Cycles;     /* executed by each job */
+  TaskHandle_t Handle;
+  TickType_t NotBefore; /* first release, -c */
+  TickType_t FirstStart;
+  uint8_t Deleted;
+  uint32_t Jobs;       /* started, -o */
+} SimTask_t;
+
+BaseType_t MsFreeRTOS_CreateEnergySavingTask( const char * const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+    void * const pvParameters, TaskHandle_t * const pxCreatedTask, uint32_t MsPeriod, uint32_t MsRelDeadLine, uint32_t MsWcet );
+void Ms_EndJob_Exec( void );
+void setup( void );
+
+extern uint32_t missedDeadline;
+extern uint32_t CountLp;
+
+/* Bandwidth of the live, admitted and deleted tasks (tasks.c), for -c       */
+typedef struct
+{
+  TickType_t Until;
+  uint32_t   U;
+} SimReclaim_t;        /* MsReclaim_t */
+
+extern SimReclaim_t MsReclaim[];
+extern uint16_t MsReclaimQnt;
+extern uint16_t taskQnt;
+extern uint32_t MsLiveU;
+#if ( MS_ADMISSION_CONTROL != MS_ADMISSION_OFF )
+extern uint32_t MsAdmU;
+#endif
+
+#if ( MS_RELEASE_QUEUE_BENCH == 1 )
+extern uint32_t ReleaseQueueBench[3][4];
+#endif
+#if ( MS_RELEASE_BATCH_BENCH == 1 )
+extern uint32_t ReleaseBatchBench[4][2];
+#endif
+
+static SimTask_t SimTasks[SIM_TASK_MAX];
+static uint32_t  SimTaskQnt;
+static uint32_t  SimEs[3] = { 181, 126, 126 };
+static double    SimDrift;     /* largest |kernel ticks - ms since the start| */
+static uint8_t   SimRefuse;    /* -r */
+static uint8_t   SimChurnOn;   /* -c */
+static uint32_t  SimChurnStep;
+static uint32_t  SimChurnErr;
+static uint32_t  SimLpEntries;  /* -l N:ms, 0: no sleep check */
+static double    SimLpMs;
+static uint32_t  SimOverrunPct; /* -o, 0: the first task as the others */
+#if ( MS_JOB_CALLBACK == 1 )
+static int       SimJobs;
+#endif
+
+#if ( MS_CBS == 1 )
+/*
+ * -a Q:T:W: every job of the first task queues a request of W ticks of work
+ * to a CBS server (Q, T). With W > Q each request exhausts the budget: it is
+ * recharged and the deadline postponed by T at least (W - 1)/Q times per
+ * request, the periodic tasks keep their deadlines whatever the requests.
+ */
+typedef struct
+{
+  uint32_t Budget, Period, Work;
+  MsServerHandle_t Handle;
+  uint32_t Requests, Served;
+} SimCbs_t;
+
+static SimCbs_t SimCbs;
+#endif
+
+#if ( MS_TRACE == 1 )
+static FILE *SimTrace;
+
+/* Trace ring into the -x file */
+static void SimTraceDrain( void )
+{
+  MsTraceRecord_t Buf[64];
+  uint32_t n;
+
+  if( SimTrace == NULL )
+    return;
+
+  while( ( n = MsFreeRTOS_TraceRead( Buf, 64 ) ) != 0 )
+    fwrite( Buf, sizeof( Buf[0] ), n, SimTrace );
+}
+#endif
+
+void vApplicationIdleHook( void )
+{
+#if ( MS_TRACE == 1 )
+  SimTraceDrain();
+#endif
+  vPortSimExecute( 100 );
+}
+
+/*
+ * Self check of the time keeping, at each job start (the kernel is awake):
+ * xTickCount is the ms of virtual time since the scheduler start, whatever
+ * the sleeps in between. A sleep on the RTC carries the part of a tick below
+ * one to the next sleep, so the check allows SIM_DRIFT_MAX ticks
+ */
+static void SimTickCheck( void )
+{
+  double d = ( double ) xTaskGetTickCount() - ( double ) ( ullPortSimTimePs() - pxPortSimStats()->StartPs ) / 1e9;
+
+  if( d < 0 )
+    d = -d;
+  if( d > SimDrift )
+    SimDrift = d;
+}
+
+static void SimTask_Func( void *pvParameters );
+#if ( MS_JOB_CALLBACK == 1 )
+static void SimJob_Func( void *pvArg );
+#endif
+
+static BaseType_t SimCreate( uint32_t i )
+{
+  char Name[configMAX_TASK_NAME_LEN];
+
+  snprintf( Name, sizeof( Name ), "Task%u", ( unsigned ) ( i + 1 ) );
+#if ( MS_JOB_CALLBACK == 1 )
+  if( SimJobs )
+    return MsFreeRTOS_CreateJob( SimJob_Func, &SimTasks[i], SimTasks[i].Period, SimTasks[i].Deadline, SimTasks[i].Wcet,
+        &SimTasks[i].Handle );
+#endif
+  return MsFreeRTOS_CreateTask( SimTask_Func, Name, SIM_STACK, &SimTasks[i], 10, &SimTasks[i].Handle,
+      SimTasks[i].Period, SimTasks[i].Deadline, SimTasks[i].Wcet );
+}
+
+static void SimChurnCheck( int Ok, const char *What )
+{
+  if( Ok )
+    return;
+
+  printf( "churn check failed at tick %u: %s\n", ( unsigned ) xTaskGetTickCount(), What );
+  SimChurnErr++;
+}
+
+/* C/P rounded up, Q16, as the kernel (Ms_AdmissionU)                      */
+static uint32_t SimU( uint32_t P, uint32_t C )
+{
+  return ( uint32_t ) ( ( ( ( uint64_t ) C << 16 ) + P - 1 ) / P );
+}
+
+/* Bandwidth of the ES task and of the tasks not deleted                   */
+static uint32_t SimLiveU( void )
+{
+  uint32_t i, U = SimU( SimEs[0], SimEs[1] );
+
+  for( i = 0; i < SimTaskQnt; i++ )
+    if( SimTasks[i].Handle != NULL )
+      U += SimU( SimTasks[i].Period, SimTasks[i].Wcet );
+  return U;
+}
+
+static void SimChurnBandwidth( const char *What )
+{
+  SimChurnCheck( MsLiveU == SimLiveU(), What );
+#if ( MS_ADMISSION_CONTROL != MS_ADMISSION_OFF )
+  SimChurnCheck( MsAdmU == MsLiveU, What );
+#endif
+}
+
+/*
+ * -c, run by the jobs of the first task:
+ *  - at SIM_CHURN_T1 the second task is deleted and created again. Its
+ *    bandwidth is held until the deadline of its last job (MsReclaim): when
+ *    the set does not fit in U <= 1 with both, the first release of the new
+ *    one waits for that deadline (SimTask_t.NotBefore, SimChurnRelease);
+ *  - at SIM_CHURN_T2 every task is deleted, the first one last, by itself:
+ *    the ES task runs alone up to the end, ListNotReady empty.
+ * The live and admitted bandwidth and the reclaim records are checked at
+ * each step, SimChurnErr counts the checks that failed.
+ */
+#define SIM_CHURN_T1                   1003
+#define SIM_CHURN_T2                   2003
+
+static void SimChurn( SimTask_t *T )
+{
+  TickType_t Now = xTaskGetTickCount();
+  uint32_t   i, u, Live;
+
+  if( T != &SimTasks[0] )
+    return;
+
+  if( SimChurnStep == 0 && Now >= SIM_CHURN_T1 )
+  {
+    SimChurnStep = 1;
+    SimChurnBandwidth( "bandwidth before the delete" );
+
+    Live = MsLiveU;
+    u    = SimU( SimTasks[1].Period, SimTasks[1].Wcet );
+    SimChurnCheck( MsFreeRTOS_DeleteTask( SimTasks[1].Handle ) == pdPASS, "delete" );
+    SimTasks[1].Handle = NULL;
+    SimChurnBandwidth( "bandwidth after the delete" );
+    SimChurnCheck( MsReclaimQnt == 1 && MsReclaim[0].U == u && MsReclaim[0].Until > Now,
+        "bandwidth held by the deleted task" );
+
+    SimTasks[1].NotBefore = ( ( uint64_t ) Live + u > 65536 ) ? MsReclaim[0].Until : Now;
+    SimChurnCheck( SimCreate( 1 ) == pdPASS, "insert again" );
+    SimChurnBandwidth( "bandwidth after the insert" );
+    SimChurnCheck( MsLiveU == Live, "bandwidth after the delete and the insert" );
+  }
+  else if( SimChurnStep == 1 && Now >= SIM_CHURN_T2 )
+  {
+    SimChurnStep = 2;
+
+    for( i = SimTaskQnt - 1; i > 0; i-- )
+    {
+      SimChurnCheck( MsFreeRTOS_DeleteTask( SimTasks[i].Handle ) == pdPASS, "delete all" );
+      SimTasks[i].Handle  = NULL;
+      SimTasks[i].Deleted = 1;
+    }
+    SimChurnBandwidth( "bandwidth after the delete of all but one" );
+    SimChurnCheck( taskQnt == 2 && MsReclaimQnt != 0, "tasks left and bandwidth held" );
+
+    SimTasks[0].Handle  = NULL;
+    SimTasks[0].Deleted = 1;
+    MsFreeRTOS_DeleteTask( NULL );
+  }
+}
+
+#if ( MS_JOB_STATS == 1 )
+/*
+ * First release of a task created at run time: the start of its first job
+ * less the release jitter of the job, read at the start of the second one.
+ * The job start may wait for a slack of the ES task after the release, the
+ * jitter takes it off.
+ */
+static void SimChurnRelease( SimTask_t *T )
+{
+  MsJobStats_t J;
+
+  if( T->NotBefore == 0 )
+    return;
+  if( T->FirstStart == 0 )
+  {
+    T->FirstStart = xTaskGetTickCount();
+    return;
+  }
+
+  MsFreeRTOS_GetJobStats( T->Handle, &J );
+  SimChurnCheck( J.Jitter.Count == 1 &&
+      T->FirstStart - J.Jitter.Max / ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) >= T->NotBefore,
+      "first release before the bandwidth of a deleted task is free" );
+  T->NotBefore = 0;
+}
+#endif
+
+#if ( MS_CBS == 1 )
+static void SimServe( void *pvRequest )
+{
+  ( void ) pvRequest;
+  vPortSimExecute( SimCbs.Work * ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) );
+  SimCbs.Served++;
+}
+
+/* Request of a job of the first task, as an ISR would queue it             */
+static void SimCbsRequest( SimTask_t *T )
+{
+  BaseType_t Woken = pdFALSE;
+
+  if( SimCbs.Handle == NULL || T != &SimTasks[0] )
+    return;
+
+  SimCbs.Requests++;
+  MsFreeRTOS_ServerRequestFromISR( SimCbs.Handle, NULL, &Woken );
+  portYIELD_FROM_ISR( Woken );
+}
+
+static int SimCbsCheck( void )
+{
+  uint32_t Replenished, Lost;
+
+  if( SimCbs.Handle == NULL )
+    return 1;
+
+  MsFreeRTOS_GetServerCounters( SimCbs.Handle, &Replenished, &Lost );
+  printf( "cbs: Q %u T %u W %u, requests %u, served %u, budgets exhausted %u, lost %u\n", ( unsigned ) SimCbs.Budget,
+      ( unsigned ) SimCbs.Period, ( unsigned ) SimCbs.Work, ( unsigned ) SimCbs.Requests, ( unsigned ) SimCbs.Served,
+      ( unsigned ) Replenished, ( unsigned ) Lost );
+
+  /* One request may still be in the server at the end of the run          */
+  return Lost == 0 && SimCbs.Served != 0 && SimCbs.Served + 1 >= SimCbs.Requests &&
+      Replenished >= SimCbs.Served * ( ( SimCbs.Work - 1 ) / SimCbs.Budget );
+}
+#endif
+
+/* Start of a job, the kernel is awake                                     */
+static void SimJobStart( SimTask_t *T )
+{
+  SimTickCheck();
+  T->Jobs++;
+#if ( MS_CBS == 1 )
+  SimCbsRequest( T );
+#endif
+  if( !SimChurnOn )
+    return;
+
+#if ( MS_JOB_STATS == 1 )
+  SimChurnRelease( T );
+#endif
+  SimChurn( T );
+}
+
+static void SimTask_Func( void *pvParameters )
+{
+  SimTask_t *T = ( SimTask_t * ) pvParameters;
+
+  while(1)
+  {
+    SimJobStart( T );
+    vPortSimExecute( T->Cycles );
+
+    Ms_EndJob_Exec();
+  }
+}
+
+#if ( MS_JOB_CALLBACK == 1 )
+static void SimJob_Func( void *pvArg )
+{
+  SimJobStart( ( SimTask_t * ) pvArg );
+  vPortSimExecute( ( ( SimTask_t * ) pvArg )->Cycles );
+}
+#endif
+
+static int SimParse( const char *Arg, uint32_t Out[3] )
+{
+  int n = sscanf( Arg, "%u:%u:%u", &Out[0], &Out[1], &Out[2] );
+
+  if( n < 2 || Out[0] == 0 || Out[1] == 0 )
+    return 0;
+  if( n == 2 )
+    Out[2] = Out[0];
+  return 1;
+}
+
+#if ( MS_JOB_STATS == 1 )
+/* One MsJobStat_t in us */
+static void SimJobStat( const char *Name, const MsJobStat_t *Stat )
+{
+  const double Us = configCPU_CLOCK_HZ / 1e6;
+
+  if( Stat->Count == 0 )
+    return;
+
+  printf( "  %-8s min %9.1f mean %9.1f max %9.1f us (%u jobs)\n", Name, Stat->Min / Us,
+      ( double ) Stat->Sum / Stat->Count / Us, Stat->Max / Us, ( unsigned ) Stat->Count );
+}
+#endif
+
+#if ( MS_RELEASE_QUEUE_BENCH == 1 ) || ( MS_RELEASE_BATCH_BENCH == 1 )
+static int SimBench;
+
+/* Ms_ReleaseQueueBench(): sorted list x heap, Ms_ReleaseBatchBench(): batch x
+ * one job at a time, host cycles */
+static void SimReleaseBench( void )
+{
+  uint32_t s;
+
+#if ( MS_RELEASE_QUEUE_BENCH == 1 )
+  static const unsigned QueueSize[3] = { 8, 32, 64 };
+
+  Ms_ReleaseQueueBench();
+  printf( "release queue  jobs  list max  list total  heap max  heap total\n" );
+  for( s = 0; s < 3; s++ )
+    printf( "               %4u  %8u  %10u  %8u  %10u\n", QueueSize[s], ( unsigned ) ReleaseQueueBench[s][0],
+        ( unsigned ) ReleaseQueueBench[s][1], ( unsigned ) ReleaseQueueBench[s][2], ( unsigned ) ReleaseQueueBench[s][3] );
+#endif
+#if ( MS_RELEASE_BATCH_BENCH == 1 )
+  static const unsigned BatchSize[4] = { 8, 16, 32, 64 };
+
+  Ms_ReleaseBatchBench();
+  printf( "release batch  jobs  batch max  one by one max\n" );
+  for( s = 0; s < 4; s++ )
+    printf( "               %4u  %9u  %14u\n", BatchSize[s], ( unsigned ) ReleaseBatchBench[s][0],
+        ( unsigned ) ReleaseBatchBench[s][1] );
+#endif
+}
+#endif
+
+static void SimUsage( void )
+{
+  fprintf( stderr, "usage: sim [-t ms] [-e percent] [-s P:C:D] [-f TASK_SET.h] [-m model] [-x file] [-j] [-b] [-r] [-c] [-l N:ms] [-a Q:T:W] [-o percent] [P:C[:D] ...]\n" );
+  exit( EXIT_FAILURE );
+}
+
+static FILE *SimOpen( const char *Name )
+{
+  FILE *f = fopen( Name, "r" );
+
+  if( f == NULL )
+  {
+    perror( Name );
+    exit( EXIT_FAILURE );
+  }
+  return f;
+}
+
+/* Tasks of a TASK_SET.h, in the order of their number */
+static void SimLoadSet( const char *Name )
+{
+  uint32_t Set[SIM_TASK_MAX + 1][3] = { { 0 } };
+  uint32_t n, v, k;
+  char Line[256], Field;
+  FILE *f = SimOpen( Name );
+
+  while( fgets( Line, sizeof( Line ), f ) != NULL )
+  {
+    if( sscanf( Line, " #define T%u_%c %u", &n, &Field, &v ) != 3 || n == 0 || n > SIM_TASK_MAX )
+      continue;
+    /* The first definition: the #ifndef defaults of the file come later    */
+    k = ( Field == 'P' ) ? 0 : ( Field == 'C' ) ? 1 : ( Field == 'D' ) ? 2 : 3;
+    if( k < 3 && Set[n][k] == 0 )
+      Set[n][k] = v;
+  }
+  fclose( f );
+
+  for( n = 1; n <= SIM_TASK_MAX && SimTaskQnt < SIM_TASK_MAX; n++ )
+  {
+    if( Set[n][0] == 0 || Set[n][1] == 0 )
+      continue;
+    SimTasks[SimTaskQnt].Period   = Set[n][0];
+    SimTasks[SimTaskQnt].Wcet     = Set[n][1];
+    SimTasks[SimTaskQnt].Deadline = ( Set[n][2] != 0 ) ? Set[n][2] : Set[n][0];
+    SimTaskQnt++;
+  }
+}
+
+/* Fields of xPortSimPower */
+static void SimLoadModel( const char *Name )
+{
+  static const struct { const char *Name; uint32_t *Field; } Fields[] =
+  {
+    { "SupplyMv",        &xPortSimPower.SupplyMv },
+    { "SleepUA",         &xPortSimPower.SleepUA },
+    { "StopUA",          &xPortSimPower.StopUA },
+    { "HsiRunUA",        &xPortSimPower.HsiRunUA },
+    { "HseRunUA",        &xPortSimPower.HseRunUA },
+    { "StopExitUs",      &xPortSimPower.StopExitUs },
+    { "SleepExitCycles", &xPortSimPower.SleepExitCycles },
+    { "HseStartUs",      &xPortSimPower.HseStartUs },
+    { "PllLockUs",       &xPortSimPower.PllLockUs },
+    { "StopTickHz",      &xPortSimPower.StopTickHz },
+    { "RefHz",           &xPortSimPower.RefHz },
+  };
+  char Line[256], Key[64];
+  uint32_t v, k, Num = 0;
+  FILE *f = SimOpen( Name );
+
+  while( fgets( Line, sizeof( Line ), f ) != NULL )
+  {
+    Num++;
+    if( sscanf( Line, " %63s", Key ) != 1 || Key[0] == '#' )
+      continue;
+
+    for( k = 0; k < sizeof( Fields ) / sizeof( Fields[0] ); k++ )
+      if( strcmp( Key, Fields[k].Name ) == 0 )
+        break;
+
+    if( k == sizeof( Fields ) / sizeof( Fields[0] ) || sscanf( Line, " %*s %u", &v ) != 1 )
+    {
+      fprintf( stderr, "%s:%u: unknown field or no value\n", Name, ( unsigned ) Num );
+      exit( EXIT_FAILURE );
+    }
+    *Fields[k].Field = v;
+  }
+  fclose( f );
+}
+
+int main( int argc, char **argv )
+{
+  const PortSimStats_t *S;
+  uint64_t RunMs = 10000;
+  uint32_t Percent = 100;
+  uint32_t P[3], i, Misses = 0, Refused = 0, LpEntries;
+  int CbsOk = 1, OverrunOk = 1;
+#if ( MS_JOB_STATS == 1 )
+  uint32_t Jobs = 0, Late = 0;
+#endif
+  double Uj = 0, Ms, Host, LpMs;
+  struct timespec T0, T1;
+  char Report[1024];
+
+  for( i = 1; i < ( uint32_t ) argc; i++ )
+  {
+    if( strcmp( argv[i], "-t" ) == 0 && i + 1 < ( uint32_t ) argc )
+      RunMs = strtoull( argv[++i], NULL, 0 );
+    else if( strcmp( argv[i], "-e" ) == 0 && i + 1 < ( uint32_t ) argc )
+      Percent = strtoul( argv[++i], NULL, 0 );
+    else if( strcmp( argv[i], "-s" ) == 0 && i + 1 < ( uint32_t ) argc )
+    {
+      if( !SimParse( argv[++i], SimEs ) )
+        SimUsage();
+    }
+    else if( strcmp( argv[i], "-f" ) == 0 && i + 1 < ( uint32_t ) argc )
+      SimLoadSet( argv[++i] );
+    else if( strcmp( argv[i], "-m" ) == 0 && i + 1 < ( uint32_t ) argc )
+      SimLoadModel( argv[++i] );
+#if ( MS_TRACE == 1 )
+    else if( strcmp( argv[i], "-x" ) == 0 && i + 1 < ( uint32_t ) argc )
+    {
+      SimTrace = fopen( argv[++i], "wb" );
+      if( SimTrace == NULL )
+      {
+        perror( argv[i] );
+        return EXIT_FAILURE;
+      }
+    }
+#endif
+#if ( MS_JOB_CALLBACK == 1 )
+    else if( strcmp( argv[i], "-j" ) == 0 )
+      SimJobs = 1;
+#endif
+#if ( MS_RELEASE_QUEUE_BENCH == 1 ) || ( MS_RELEASE_BATCH_BENCH == 1 )
+    else if( strcmp( argv[i], "-b" ) == 0 )
+      SimBench = 1;
+#endif
+    else if( strcmp( argv[i], "-r" ) == 0 )
+      SimRefuse = 1;
+    else if( strcmp( argv[i], "-c" ) == 0 )
+      SimChurnOn = 1;
+    else if( strcmp( argv[i], "-l" ) == 0 && i + 1 < ( uint32_t ) argc )
+    {
+      char *End;
+
+      SimLpEntries = strtoul( argv[++i], &End, 0 );
+      if( *End != ':' || SimLpEntries == 0 )
+        SimUsage();
+      SimLpMs = strtod( End + 1, NULL );
+    }
+    else if( strcmp( argv[i], "-o" ) == 0 && i + 1 < ( uint32_t ) argc )
+    {
+      SimOverrunPct = strtoul( argv[++i], NULL, 0 );
+      if( SimOverrunPct <= 100 )
+        SimUsage();
+    }
+#if ( MS_CBS == 1 )
+    else if( strcmp( argv[i], "-a" ) == 0 && i + 1 < ( uint32_t ) argc )
+    {
+      if( sscanf( argv[++i], "%u:%u:%u", &SimCbs.Budget, &SimCbs.Period, &SimCbs.Work ) != 3 || SimCbs.Budget == 0 ||
+          SimCbs.Work == 0 )
+        SimUsage();
+    }
+#endif
+    else if( SimTaskQnt < SIM_TASK_MAX && SimParse( argv[i], P ) )
+    {
+      SimTasks[SimTaskQnt].Period   = P[0];
+      SimTasks[SimTaskQnt].Wcet     = P[1];
+      SimTasks[SimTaskQnt].Deadline = P[2];
+      SimTaskQnt++;
+    }
+    else
+      SimUsage();
+  }
+
+  if( SimTaskQnt == 0 )
+  {
+    SimTasks[0] = ( SimTask_t ){ 5, 5, 1, 0, NULL };
+    SimTasks[1] = ( SimTask_t ){ 10, 10, 3, 0, NULL };
+    SimTaskQnt = 2;
+  }
+  if( SimChurnOn && SimTaskQnt < 2 )
+    SimUsage();
+
+  Sys_Configure_Clock_168MHz();
+
+  setup();
+
+#if ( MS_RELEASE_QUEUE_BENCH == 1 ) || ( MS_RELEASE_BATCH_BENCH == 1 )
+  if( SimBench )
+  {
+    SimReleaseBench();
+    return EXIT_SUCCESS;
+  }
+#endif
+
+  MsFreeRTOS_CreateEnergySavingTask( "Es Task", SIM_STACK, NULL, NULL, SimEs[0], SimEs[2], SimEs[1] );
+
+  for( i = 0; i < SimTaskQnt; i++ )
+  {
+    SimTasks[i].Cycles = ( uint32_t ) ( ( uint64_t ) SimTasks[i].Wcet * ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) *
+        ( ( i == 0 && SimOverrunPct != 0 ) ? SimOverrunPct : Percent ) / 100 );
+
+    /* Refused: no handle, the NULL of the counters is the calling task      */
+    if( SimCreate( i ) != pdPASS )
+    {
+      SimTasks[i].Handle = NULL;
+      Refused++;
+    }
+  }
+
+#if ( MS_CBS == 1 )
+  if( SimCbs.Budget != 0 &&
+      MsFreeRTOS_CreateServer( SimServe, "Server", SIM_STACK, SimCbs.Budget, SimCbs.Period, &SimCbs.Handle ) != pdPASS )
+  {
+    fprintf( stderr, "sim: CBS server %u:%u refused\n", ( unsigned ) SimCbs.Budget, ( unsigned ) SimCbs.Period );
+    return EXIT_FAILURE;
+  }
+#endif
+
+  vPortSimSetEndTime( RunMs * 1000 );
+  clock_gettime( CLOCK_MONOTONIC, &T0 );
+  vTaskStartScheduler();
+  clock_gettime( CLOCK_MONOTONIC, &T1 );
+  Host = ( double ) ( T1.tv_sec - T0.tv_sec ) + ( double ) ( T1.tv_nsec - T0.tv_nsec ) / 1e9;
+
+#if ( MS_TRACE == 1 )
+  SimTraceDrain();
+  if( SimTrace != NULL )
+    fclose( SimTrace );
+#endif
+
+  S = pxPortSimStats();
+  Ms = ( double ) ullPortSimTimePs() / 1e9;
+
+  printf( "time %.3f ms%s, kernel ticks %u, SysTick interrupts %u, switches %u, cycles %llu\n", Ms, S->Stalled ? " (stalled)" : "",
+      ( unsigned ) xTaskGetTickCount(), ( unsigned ) S->Ticks, ( unsigned ) S->Switches, ( unsigned long long ) S->Cycles );
+  printf( "tick check: drift %.3f ticks at most at a job start%s\n", SimDrift, ( SimDrift > SIM_DRIFT_MAX ) ? " FAILED" : "" );
+  printf( "missed deadlines %u, low power entries %u, ES decisions %u, sleeps %u\n",
+      ( unsigned ) missedDeadline, ( unsigned ) CountLp, ( unsigned ) MsEsStats.Decisions, ( unsigned ) MsEsStats.Sleeps );
+  printf( "ES entries after a job end %u, latency max %u cycles, total %u us\n", ( unsigned ) MsEsStats.Entries,
+      ( unsigned ) MsEsStats.MaxEntryCycles, ( unsigned ) MsEsStats.AcumUs );
+
+  for( i = 0; i < SimTaskQnt; i++ )
+  {
+    uint32_t Overrun, Missed;
+    int Excused = 0;
+
+    if( SimTasks[i].Handle == NULL )
+    {
+      printf( "Task%u  P %u C %u D %u  %s\n", ( unsigned ) ( i + 1 ), ( unsigned ) SimTasks[i].Period,
+          ( unsigned ) SimTasks[i].Wcet, ( unsigned ) SimTasks[i].Deadline, SimTasks[i].Deleted ? "deleted" : "refused" );
+      continue;
+    }
+
+    MsFreeRTOS_GetJobCounters( SimTasks[i].Handle, &Overrun, &Missed );
+    printf( "Task%u  P %u C %u D %u  missed %u overrun %u\n", ( unsigned ) ( i + 1 ), ( unsigned ) SimTasks[i].Period,
+        ( unsigned ) SimTasks[i].Wcet, ( unsigned ) SimTasks[i].Deadline, ( unsigned ) Missed, ( unsigned ) Overrun );
+    if( i == 0 && SimOverrunPct != 0 )
+    {
+      /* The last job may be cut by the end of the run                      */
+      OverrunOk = Overrun != 0 && Overrun + 1 >= SimTasks[0].Jobs;
+      printf( "overrun check: %u%% of the WCET, %u jobs, %u overruns%s\n", ( unsigned ) SimOverrunPct,
+          ( unsigned ) SimTasks[0].Jobs, ( unsigned ) Overrun, OverrunOk ? "" : " FAILED" );
+#if ( MS_OVERRUN_POLICY == MS_OVERRUN_BACKGROUND )
+      /* Its jobs end in the background, past their deadlines              */
+      Excused         = 1;
+      missedDeadline -= Missed;
+#endif
+    }
+    if( !Excused )
+      Misses += Missed;
+#if ( MS_JOB_STATS == 1 )
+    {
+      MsJobStats_t J;
+
+      MsFreeRTOS_GetJobStats( SimTasks[i].Handle, &J );
+      SimJobStat( "response", &J.Response );
+      SimJobStat( "exec", &J.Exec );
+      SimJobStat( "jitter", &J.Jitter );
+      Jobs += J.Response.Count;
+      Late += J.Late;
+      if( !Excused )
+        Misses += J.Late;
+    }
+#endif
+  }
+
+#if ( MS_JOB_STATS == 1 )
+  printf( "jobs %u, late %u, miss ratio %.6f, host %.3f s, %.0f jobs/s\n", ( unsigned ) Jobs, ( unsigned ) Late,
+      ( Jobs != 0 ) ? ( double ) Late / Jobs : 0.0, Host, ( Host > 0 ) ? Jobs / Host : 0.0 );
+#else
+  printf( "host %.3f s\n", Host );
+#endif
+
+  printf( "sim   RUN %10.3f ms %10.1f uJ  SLEEP %10.3f ms %10.1f uJ (%u)  STOP %10.3f ms %10.1f uJ (%u)  wake %.3f ms %.1f uJ\n",
+      ( double ) S->Ps[portSIM_RUN] / 1e9, S->Uj[portSIM_RUN],
+      ( double ) S->Ps[portSIM_SLEEP] / 1e9, S->Uj[portSIM_SLEEP], ( unsigned ) S->Entries[portSIM_SLEEP],
+      ( double ) S->Ps[portSIM_STOP] / 1e9, S->Uj[portSIM_STOP], ( unsigned ) S->Entries[portSIM_STOP],
+      ( double ) S->WakePs / 1e9, S->WakeUj );
+
+  for( i = portSIM_SLEEP; i <= portSIM_STOP; i++ )
+    printf( "sim   %-5s %u entries, mean %.3f ms, max %.3f ms\n", ( i == portSIM_SLEEP ) ? "SLEEP" : "STOP",
+        ( unsigned ) S->Entries[i], S->Entries[i] ? ( double ) S->Ps[i] / 1e9 / S->Entries[i] : 0.0, ( double ) S->MaxPs[i] / 1e9 );
+
+  LpEntries = S->Entries[portSIM_SLEEP] + S->Entries[portSIM_STOP];
+  LpMs      = ( double ) ( S->Ps[portSIM_SLEEP] + S->Ps[portSIM_STOP] ) / 1e9;
+  printf( "sleep check: %u entries, %.3f ms", ( unsigned ) LpEntries, LpMs );
+  if( SimLpEntries != 0 )
+    printf( " against fewer than %u, more than %.3f ms%s", ( unsigned ) SimLpEntries, SimLpMs,
+        ( LpEntries < SimLpEntries && LpMs > SimLpMs ) ? "" : " FAILED" );
+  printf( "\n" );
+
+  for( i = 0; i < portSIM_MODES; i++ )
+    Uj += S->Uj[i];
+  Uj += S->WakeUj;
+  printf( "sim   energy %.1f uJ, mean power %.3f mW\n", Uj, ( Ms > 0 ) ? Uj / Ms : 0.0 );
+
+#if ( MS_ENERGY == 1 )
+  MsFreeRTOS_EnergyReport( Report, sizeof( Report ) );
+  printf( "kernel accounting:\n%s", Report );
+#else
+  ( void ) Report;
+#endif
+
+  if( SimChurnOn )
+  {
+    SimChurnCheck( SimChurnStep == 2 && taskQnt == 1, "every task deleted" );
+    SimChurnBandwidth( "bandwidth of the ES task alone" );
+    printf( "churn checks failed %u\n", ( unsigned ) SimChurnErr );
+  }
+
+#if ( MS_CBS == 1 )
+  CbsOk = SimCbsCheck();
+#endif
+
+  return ( S->Stalled != 0 || SimDrift > SIM_DRIFT_MAX || missedDeadline + Misses != 0 ||
+      ( SimRefuse && Refused != SimTaskQnt ) || SimChurnErr != 0 || !CbsOk || !OverrunOk ||
+      ( SimLpEntries != 0 && ( LpEntries >= SimLpEntries || LpMs <= SimLpMs ) ) ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
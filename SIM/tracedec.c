@@ -0,0 +1,417 @@
+/*
+ * Decoder of the MS_TRACE binary trace (MsTraceRecord_t records, as read by
+ * MsFreeRTOS_TraceRead) into the Chrome trace event JSON, which
+ * ui.perfetto.dev and chrome://tracing open, and per task response time
+ * histograms.
+ *
+ *   tracedec [-c hz] [-o file.json] trace.bin
+ *
+ *   -c  rate of the overhead cycles of the SWITCH, TICK and BATCH records
+ *       (default the DWT rate of the header)
+ *   -o  JSON output (default stdout)
+ *
+ * The tracks: one per task with its run slices and its jobs from release to
+ * end, "Kernel" with the tick, context switch and release overheads, "Power"
+ * with the SLEEP, STOP and Standby periods and the clock restores. The
+ * histograms of the response times (release to end, log2 buckets in us) go
+ * to stderr.
+ *
+ * The DWT counter wraps every 25 s at 168 MHz and stops in STOP: the time line
+ * is the kernel tick of the TICK and LP_EXIT records plus the DWT cycles since
+ * the last of them. The overheads of the host simulation are host cycles.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MS_FREERTOS.h"
+
+#define DEC_TASK_MAX                   256
+#define DEC_NAME_MAX                   32
+#define DEC_BUCKETS                    32
+
+#define DEC_TID_KERNEL                 1
+#define DEC_TID_POWER                  2
+#define DEC_TID_IDLE                   99
+#define DEC_TID_TASK                   100
+
+#define DEC_ID_NONE                    0xFFFF
+
+typedef struct
+{
+  char     Name[DEC_NAME_MAX];
+  uint8_t  Seen;
+  uint8_t  Named;          /* Name from MS_TRACE_NAME records              */
+  uint8_t  Open;           /* job released and not ended                   */
+  uint64_t Job;            /* async id of the open job                     */
+  double   Release;        /* us                                           */
+  uint32_t Jobs;
+  uint32_t Misses;
+  double   Min, Max, Sum;
+  uint32_t Hist[DEC_BUCKETS];
+} DecTask_t;
+
+static DecTask_t DecTasks[DEC_TASK_MAX];
+static FILE     *DecOut;
+static int       DecFirst = 1;
+static uint64_t  DecJobId;
+
+/* Time line */
+static double    DecCpuHz  = configCPU_CLOCK_HZ;
+static double    DecTickHz = configTICK_RATE_HZ;
+static double    DecOvhHz;
+static uint32_t  DecDwt;           /* DWT of the anchor                      */
+static double    DecAnchor;        /* us of the anchor                       */
+static uint32_t  DecTick;          /* unwrapped tick count                   */
+static double    DecLast;          /* last time given, us                    */
+
+static void DecUsage( void )
+{
+  fprintf( stderr, "usage: tracedec [-c hz] [-o file.json] trace.bin\n" );
+  exit( EXIT_FAILURE );
+}
+
+/* One element of traceEvents */
+static void __attribute__( ( format( printf, 1, 2 ) ) ) DecEvent( const char *Fmt, ... )
+{
+  va_list Ap;
+
+  fputs( DecFirst ? "\n  " : ",\n  ", DecOut );
+  DecFirst = 0;
+
+  va_start( Ap, Fmt );
+  vfprintf( DecOut, Fmt, Ap );
+  va_end( Ap );
+}
+
+static int DecTid( uint16_t Id )
+{
+  if( Id == DEC_ID_NONE || Id >= DEC_TASK_MAX )
+    return DEC_TID_IDLE;
+  return DEC_TID_TASK + Id;
+}
+
+static DecTask_t *DecTaskOf( uint16_t Id )
+{
+  if( Id >= DEC_TASK_MAX )
+    return NULL;
+
+  if( !DecTasks[Id].Seen )
+  {
+    DecTasks[Id].Seen = 1;
+    DecTasks[Id].Min  = 1e300;
+    if( DecTasks[Id].Name[0] == 0 )
+      snprintf( DecTasks[Id].Name, DEC_NAME_MAX, "Task %u", ( unsigned ) Id );
+  }
+  return &DecTasks[Id];
+}
+
+/* DWT time of a record in us, monotonic */
+static double DecTime( uint32_t Dwt )
+{
+  double t = DecAnchor + ( double )( uint32_t )( Dwt - DecDwt ) * 1e6 / DecCpuHz;
+
+  if( t < DecLast )
+    t = DecLast;
+  DecLast = t;
+  return t;
+}
+
+/* The record is at the kernel tick Tick: new anchor of the time line */
+static void DecAnchorAt( uint32_t Dwt, uint32_t Tick )
+{
+  double t = ( double ) Tick * 1e6 / DecTickHz;
+
+  DecTick = Tick;
+  DecDwt  = Dwt;
+  DecAnchor = ( t > DecLast ) ? t : DecLast;
+}
+
+/* Kernel overhead of Cycles that ended at t */
+static void DecOverhead( const char *Name, double t, uint32_t Cycles, uint16_t Id )
+{
+  double Dur = ( double ) Cycles * 1e6 / ( DecOvhHz ? DecOvhHz : DecCpuHz );
+  double Start = ( t > Dur ) ? t - Dur : 0;
+
+  DecEvent( "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"cycles\":%u,\"id\":%u}}",
+      DEC_TID_KERNEL, Name, Start, t - Start, ( unsigned ) Cycles, ( unsigned ) Id );
+}
+
+static void DecResponse( DecTask_t *T, double Us )
+{
+  uint32_t b = 0;
+  uint64_t v = ( Us < 1 ) ? 0 : ( uint64_t ) Us;
+
+  while( v > 1 && b < DEC_BUCKETS - 1 )
+  {
+    v >>= 1;
+    b++;
+  }
+
+  T->Jobs++;
+  T->Sum += Us;
+  if( Us < T->Min )
+    T->Min = Us;
+  if( Us > T->Max )
+    T->Max = Us;
+  T->Hist[b]++;
+}
+
+static void DecReport( void )
+{
+  uint32_t Id, b, Peak, k;
+
+  for( Id = 0; Id < DEC_TASK_MAX; Id++ )
+  {
+    DecTask_t *T = &DecTasks[Id];
+
+    if( !T->Seen || T->Jobs == 0 )
+      continue;
+
+    fprintf( stderr, "%-16s jobs %u misses %u  response min %.1f mean %.1f max %.1f us\n", T->Name,
+        ( unsigned ) T->Jobs, ( unsigned ) T->Misses, T->Min, T->Sum / T->Jobs, T->Max );
+
+    for( b = 0, Peak = 1; b < DEC_BUCKETS; b++ )
+      if( T->Hist[b] > Peak )
+        Peak = T->Hist[b];
+
+    for( b = 0; b < DEC_BUCKETS; b++ )
+    {
+      if( T->Hist[b] == 0 )
+        continue;
+      fprintf( stderr, "  %10llu us %8u ", ( unsigned long long ) ( b ? 1ull << b : 0 ), ( unsigned ) T->Hist[b] );
+      for( k = 0; k < ( T->Hist[b] * 40 + Peak - 1 ) / Peak; k++ )
+        fputc( '#', stderr );
+      fputc( '\n', stderr );
+    }
+  }
+}
+
+int main( int argc, char **argv )
+{
+  static const char *LpName[] = { "RUN", "SLEEP", "STOP", "Standby" };
+  MsTraceRecord_t R;
+  const char *In = NULL, *Out = NULL;
+  FILE *f;
+  int i;
+  double t, LpStart = 0, RunStart = 0;
+  uint16_t Run = DEC_ID_NONE;
+  uint8_t Running = 0, LpOpen = 0, LpMode = 0;
+  uint32_t Lost = 0, Records = 0, Id;
+
+  _Static_assert( sizeof( MsTraceRecord_t ) == 12, "MsTraceRecord_t is 12 bytes" );
+
+  for( i = 1; i < argc; i++ )
+  {
+    if( strcmp( argv[i], "-c" ) == 0 && i + 1 < argc )
+      DecOvhHz = strtod( argv[++i], NULL );
+    else if( strcmp( argv[i], "-o" ) == 0 && i + 1 < argc )
+      Out = argv[++i];
+    else if( argv[i][0] != '-' && In == NULL )
+      In = argv[i];
+    else
+      DecUsage();
+  }
+  if( In == NULL )
+    DecUsage();
+
+  f = fopen( In, "rb" );
+  if( f == NULL )
+  {
+    perror( In );
+    return EXIT_FAILURE;
+  }
+  DecOut = ( Out != NULL ) ? fopen( Out, "w" ) : stdout;
+  if( DecOut == NULL )
+  {
+    perror( Out );
+    return EXIT_FAILURE;
+  }
+
+  fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", DecOut );
+
+  while( fread( &R, sizeof( R ), 1, f ) == 1 )
+  {
+    Records++;
+
+    /* No time in these two */
+    if( R.Event == MS_TRACE_NAME )
+    {
+      DecTask_t *T = DecTaskOf( R.Id );
+      size_t n;
+
+      if( T == NULL )
+        continue;
+      /* Offset 0: the task was named again (its MsID changed)              */
+      if( !T->Named || R.Time == 0 )
+        T->Name[0] = 0;
+      T->Named = 1;
+      n = strlen( T->Name );
+      for( i = 0; i < 4 && n < DEC_NAME_MAX - 1; i++ )
+      {
+        char c = ( char )( R.Arg >> ( 8 * i ) );
+
+        if( c == 0 )
+          break;
+        T->Name[n++] = ( c == '"' || c == '\\' || ( unsigned char ) c < 0x20 ) ? '_' : c;
+      }
+      T->Name[n] = 0;
+      continue;
+    }
+    if( R.Event == MS_TRACE_LOST )
+    {
+      Lost += R.Arg;
+      DecEvent( "{\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"name\":\"Lost\",\"ts\":%.3f,\"args\":{\"records\":%u}}",
+          DEC_TID_KERNEL, DecLast, ( unsigned ) R.Arg );
+      continue;
+    }
+
+    if( R.Event == MS_TRACE_HEADER )
+    {
+      DecTickHz = R.Id;
+      DecCpuHz  = R.Arg;
+      DecDwt    = R.Time;
+      DecAnchor = DecLast;
+      for( Id = 0; Id < DEC_TASK_MAX; Id++ )
+        if( DecTasks[Id].Seen )
+        {
+          /* First jobs, released before the start of the scheduler */
+          DecTasks[Id].Open = 1;
+          DecTasks[Id].Job  = ++DecJobId;
+          DecTasks[Id].Release = DecLast;
+          DecEvent( "{\"ph\":\"b\",\"cat\":\"job\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"name\":\"job\",\"ts\":%.3f}",
+              ( unsigned long long ) DecTasks[Id].Job, DecTid( ( uint16_t ) Id ), DecLast );
+        }
+      continue;
+    }
+
+    if( R.Event == MS_TRACE_TICK )
+    {
+      DecAnchorAt( R.Time, DecTick + ( uint16_t )( R.Id - ( uint16_t ) DecTick ) );
+      t = DecTime( R.Time );
+      DecOverhead( "Tick", t, R.Arg, R.Id );
+      continue;
+    }
+    if( R.Event == MS_TRACE_LP_EXIT )
+      DecAnchorAt( R.Time, R.Arg );
+
+    t = DecTime( R.Time );
+
+    switch( R.Event )
+    {
+      case MS_TRACE_SWITCH:
+        if( Running )
+          DecEvent( "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"run\",\"ts\":%.3f,\"dur\":%.3f}",
+              DecTid( Run ), RunStart, t - RunStart );
+        Run = R.Id;
+        RunStart = t;
+        Running = 1;
+        if( R.Id != DEC_ID_NONE )
+          DecTaskOf( R.Id );
+        DecOverhead( "Switch", t, R.Arg, R.Id );
+        break;
+
+      case MS_TRACE_BATCH:
+        DecOverhead( "Release", t, R.Arg, R.Id );
+        break;
+
+      case MS_TRACE_RELEASE:
+      {
+        DecTask_t *T = DecTaskOf( R.Id );
+
+        if( T == NULL )
+          break;
+        if( T->Open )
+          DecEvent( "{\"ph\":\"e\",\"cat\":\"job\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"name\":\"job\",\"ts\":%.3f}",
+              ( unsigned long long ) T->Job, DecTid( R.Id ), t );
+        T->Open = 1;
+        T->Job  = ++DecJobId;
+        T->Release = t;
+        DecEvent( "{\"ph\":\"b\",\"cat\":\"job\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"name\":\"job\",\"ts\":%.3f,\"args\":{\"deadline\":%u}}",
+            ( unsigned long long ) T->Job, DecTid( R.Id ), t, ( unsigned ) R.Arg );
+        break;
+      }
+
+      case MS_TRACE_END:
+      {
+        DecTask_t *T = DecTaskOf( R.Id );
+
+        if( T == NULL || !T->Open )
+          break;
+        T->Open = 0;
+        DecResponse( T, t - T->Release );
+        DecEvent( "{\"ph\":\"e\",\"cat\":\"job\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"name\":\"job\",\"ts\":%.3f,\"args\":{\"lateness\":%d}}",
+            ( unsigned long long ) T->Job, DecTid( R.Id ), t, ( int ) R.Arg );
+        break;
+      }
+
+      case MS_TRACE_PREEMPT:
+        DecEvent( "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"name\":\"preempted\",\"ts\":%.3f,\"args\":{\"by\":%u}}",
+            DecTid( R.Id ), t, ( unsigned ) R.Arg );
+        break;
+
+      case MS_TRACE_MISS:
+        if( DecTaskOf( R.Id ) != NULL )
+          DecTasks[R.Id].Misses++;
+        DecEvent( "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"name\":\"miss\",\"ts\":%.3f,\"args\":{\"deadline\":%u}}",
+            DecTid( R.Id ), t, ( unsigned ) R.Arg );
+        break;
+
+      case MS_TRACE_LP_ENTER:
+        LpOpen  = 1;
+        LpMode  = ( R.Id < 4 ) ? ( uint8_t ) R.Id : 0;
+        LpStart = t;
+        if( LpMode == MS_TRACE_STANDBY )
+        {
+          /* A reset ends it */
+          DecEvent( "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"name\":\"Standby\",\"ts\":%.3f,\"args\":{\"slack\":%u}}",
+              DEC_TID_POWER, t, ( unsigned ) R.Arg );
+          LpOpen = 0;
+        }
+        break;
+
+      case MS_TRACE_LP_EXIT:
+        if( LpOpen )
+          DecEvent( "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"tick\":%u}}",
+              DEC_TID_POWER, LpName[LpMode], LpStart, t - LpStart, ( unsigned ) R.Arg );
+        LpOpen = 0;
+        break;
+
+      case MS_TRACE_CLOCK:
+        DecEvent( "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"args\":{\"us\":%u}}",
+            DEC_TID_POWER, ( R.Id == MS_TRACE_CLOCK_HSI ) ? "HSI" : "PLL", t, ( unsigned ) R.Arg );
+        break;
+
+      default:
+        break;
+    }
+  }
+  fclose( f );
+
+  if( Running )
+    DecEvent( "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"run\",\"ts\":%.3f,\"dur\":%.3f}",
+        DecTid( Run ), RunStart, DecLast - RunStart );
+
+  DecEvent( "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"ES-EDF\"}}" );
+  DecEvent( "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"Kernel\"}}", DEC_TID_KERNEL );
+  DecEvent( "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"Power\"}}", DEC_TID_POWER );
+  DecEvent( "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"Idle\"}}", DEC_TID_IDLE );
+  for( Id = 0; Id < DEC_TASK_MAX; Id++ )
+    if( DecTasks[Id].Seen )
+      DecEvent( "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+          DecTid( ( uint16_t ) Id ), DecTasks[Id].Name );
+
+  fputs( "\n]}\n", DecOut );
+  if( DecOut != stdout )
+    fclose( DecOut );
+
+  fprintf( stderr, "%u records, %u lost, %.3f ms\n", ( unsigned ) Records, ( unsigned ) Lost, DecLast / 1000 );
+  DecReport();
+
+  return EXIT_SUCCESS;
+}